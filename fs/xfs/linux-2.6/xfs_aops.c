@@ -118,9 +118,12 @@ xfs_find_bdev_for_inode(
 		return mp->m_ddev_targp->bt_bdev;
 }
 
+STATIC void xfs_queue_unwritten(xfs_ioend_t *);
+
 /*
  * Schedule IO completion handling on a xfsdatad if this was
- * the final hold on this ioend. If we are asked to wait,
+ * the final hold on this ioend, or on xfsconvertd if it needs
+ * unwritten extent conversion. If we are asked to wait,
  * flush the workqueue.
  */
 STATIC void
@@ -129,12 +132,58 @@ xfs_finish_ioend(
 	int		wait)
 {
 	if (atomic_dec_and_test(&ioend->io_remaining)) {
+		if (ioend->io_type == IOMAP_UNWRITTEN) {
+			xfs_queue_unwritten(ioend);
+			if (wait)
+				flush_workqueue(xfsconvertd_workqueue);
+			return;
+		}
 		queue_work(xfsdatad_workqueue, &ioend->io_work);
 		if (wait)
 			flush_workqueue(xfsdatad_workqueue);
 	}
 }
 
+/*
+ * Streaming writeback normally puts every buffer of a page into the
+ * same ioend, in page order.  When that is the case for the page bh
+ * starts, nobody else can be completing buffers on it, so finish the
+ * whole page here and return the buffer following it in the ioend.
+ * This saves end_buffer_async_write() taking the page's buffer state
+ * lock with interrupts disabled and rescanning the page for each block.
+ * The rescan is only per block when the block size is below the page
+ * size; with one buffer per page this still costs one call per page and
+ * only the lock round trip is avoided.
+ */
+STATIC int
+xfs_end_page_buffers(
+	struct buffer_head	*bh,
+	struct buffer_head	**nextp)
+{
+	struct page		*page = bh->b_page;
+	struct buffer_head	*head = page_buffers(page);
+	struct buffer_head	*tmp, *next;
+
+	if (bh != head)
+		return 0;
+	for (tmp = bh; tmp->b_this_page != head; tmp = tmp->b_this_page) {
+		if (tmp->b_private != tmp->b_this_page)
+			return 0;
+	}
+	*nextp = tmp->b_private;
+
+	tmp = bh;
+	do {
+		next = tmp->b_this_page;
+		ASSERT(buffer_async_write(tmp));
+		set_buffer_uptodate(tmp);
+		clear_buffer_async_write(tmp);
+		unlock_buffer(tmp);
+	} while ((tmp = next) != head);
+	end_page_writeback(page);
+	return 1;
+}
+
 /*
  * We're now finished for good with this ioend structure.
  * Update the page state via the associated buffer_heads,
@@ -148,6 +197,8 @@ xfs_destroy_ioend(
 	struct buffer_head	*bh, *next;
 
 	for (bh = ioend->io_buffer_head; bh; bh = next) {
+		if (!ioend->io_error && xfs_end_page_buffers(bh, &next))
+			continue;
 		next = bh->b_private;
 		bh->b_end_io(bh, !ioend->io_error);
 	}
@@ -191,6 +242,7 @@ xfs_setfilesize(
 		ip->i_d.di_size = isize;
 		ip->i_update_core = 1;
 		ip->i_update_size = 1;
+		ip->i_update_lazy = 0;
 		xfs_mark_inode_dirty_sync(ip);
 	}
 
@@ -228,29 +280,149 @@ xfs_end_bio_written(
 /*
  * IO write completion for unwritten extents.
  *
- * Issue transactions to convert a buffer range from unwritten
- * to written extents.
+ * Completed unwritten ioends are queued on a per-cpu list and converted
+ * from xfsconvertd rather than xfsdatad, so that a stream of conversion
+ * transactions cannot hold up regular I/O completion.  When the queue is
+ * run, ioends for the same inode that cover adjacent ranges are merged
+ * and converted in one call to xfs_iomap_write_unwritten(), which needs
+ * only one transaction per extent touched rather than one per ioend.
  */
+#define XFS_CONVERT_BATCH	32	/* max ioends converted together */
+
+typedef struct xfs_convert_queue {
+	spinlock_t		cq_lock;	/* protects the list */
+	xfs_ioend_t		*cq_head;	/* ioends awaiting conversion */
+	xfs_ioend_t		*cq_tail;
+	struct work_struct	cq_work;	/* xfsconvertd work item */
+} xfs_convert_queue_t;
+
+static DEFINE_PER_CPU(xfs_convert_queue_t, xfs_convert_queues);
+
+/*
+ * Pull every error free ioend for the same inode that is adjacent to
+ * the range [*offset, *end) off the list and onto the batch headed by
+ * ioend, growing the range as we go.  Rescan after each merge as the
+ * completions may not arrive in file offset order.
+ */
+STATIC void
+xfs_convert_gather(
+	xfs_ioend_t		*ioend,
+	xfs_ioend_t		**listp,
+	xfs_off_t		*offset,
+	xfs_off_t		*end)
+{
+	xfs_ioend_t		*tail = ioend;
+	xfs_ioend_t		**prevp;
+	xfs_ioend_t		*next;
+	int			count = 1;
+	int			merged;
+
+	do {
+		merged = 0;
+		for (prevp = listp; (next = *prevp) != NULL; ) {
+			if (next->io_inode != ioend->io_inode ||
+			    next->io_error ||
+			    (next->io_offset != *end &&
+			     next->io_offset + next->io_size != *offset)) {
+				prevp = &next->io_list;
+				continue;
+			}
+			*prevp = next->io_list;
+			next->io_list = NULL;
+			tail->io_list = next;
+			tail = next;
+
+			if (next->io_offset == *end)
+				*end += next->io_size;
+			else
+				*offset = next->io_offset;
+			merged = 1;
+			if (++count >= XFS_CONVERT_BATCH)
+				return;
+		}
+	} while (merged);
+}
+
 STATIC void
 xfs_end_bio_unwritten(
 	struct work_struct	*work)
 {
-	xfs_ioend_t		*ioend =
-		container_of(work, xfs_ioend_t, io_work);
-	struct xfs_inode	*ip = XFS_I(ioend->io_inode);
-	xfs_off_t		offset = ioend->io_offset;
-	size_t			size = ioend->io_size;
-
-	if (likely(!ioend->io_error)) {
-		if (!XFS_FORCED_SHUTDOWN(ip->i_mount)) {
-			int error;
-			error = xfs_iomap_write_unwritten(ip, offset, size);
+	xfs_convert_queue_t	*cq =
+		container_of(work, xfs_convert_queue_t, cq_work);
+	xfs_ioend_t		*list;
+	xfs_ioend_t		*ioend;
+	xfs_ioend_t		*next;
+	struct xfs_inode	*ip;
+	xfs_off_t		offset;
+	xfs_off_t		end;
+	int			error;
+
+	spin_lock_irq(&cq->cq_lock);
+	list = cq->cq_head;
+	cq->cq_head = cq->cq_tail = NULL;
+	spin_unlock_irq(&cq->cq_lock);
+
+	while ((ioend = list) != NULL) {
+		list = ioend->io_list;
+		ioend->io_list = NULL;
+		ip = XFS_I(ioend->io_inode);
+
+		error = 0;
+		if (likely(!ioend->io_error)) {
+			offset = ioend->io_offset;
+			end = offset + ioend->io_size;
+			xfs_convert_gather(ioend, &list, &offset, &end);
+			if (!XFS_FORCED_SHUTDOWN(ip->i_mount))
+				error = xfs_iomap_write_unwritten(ip, offset,
+							end - offset);
+		}
+
+		for (; ioend; ioend = next) {
+			next = ioend->io_list;
 			if (error)
 				ioend->io_error = error;
+			xfs_setfilesize(ioend);
+			xfs_destroy_ioend(ioend);
 		}
-		xfs_setfilesize(ioend);
 	}
-	xfs_destroy_ioend(ioend);
+}
+
+/*
+ * Queue a completed unwritten ioend for conversion on this cpu's list.
+ * This can be called from interrupt context.
+ */
+STATIC void
+xfs_queue_unwritten(
+	xfs_ioend_t		*ioend)
+{
+	xfs_convert_queue_t	*cq;
+	unsigned long		flags;
+
+	ioend->io_list = NULL;
+	cq = &get_cpu_var(xfs_convert_queues);
+	spin_lock_irqsave(&cq->cq_lock, flags);
+	if (cq->cq_tail)
+		cq->cq_tail->io_list = ioend;
+	else
+		cq->cq_head = ioend;
+	cq->cq_tail = ioend;
+	spin_unlock_irqrestore(&cq->cq_lock, flags);
+	queue_work(xfsconvertd_workqueue, &cq->cq_work);
+	put_cpu_var(xfs_convert_queues);
+}
+
+void __init
+xfs_convert_queue_init(void)
+{
+	xfs_convert_queue_t	*cq;
+	int			cpu;
+
+	for_each_possible_cpu(cpu) {
+		cq = &per_cpu(xfs_convert_queues, cpu);
+		spin_lock_init(&cq->cq_lock);
+		cq->cq_head = cq->cq_tail = NULL;
+		INIT_WORK(&cq->cq_work, xfs_end_bio_unwritten);
+	}
 }
 
 /*
@@ -297,9 +469,7 @@ xfs_alloc_ioend(
 	ioend->io_offset = 0;
 	ioend->io_size = 0;
 
-	if (type == IOMAP_UNWRITTEN)
-		INIT_WORK(&ioend->io_work, xfs_end_bio_unwritten);
-	else if (type == IOMAP_DELAY)
+	if (type == IOMAP_DELAY)
 		INIT_WORK(&ioend->io_work, xfs_end_bio_delalloc);
 	else if (type == IOMAP_READ)
 		INIT_WORK(&ioend->io_work, xfs_end_bio_read);
@@ -422,11 +592,6 @@ xfs_start_page_writeback(
 		end_page_writeback(page);
 }
 
-static inline int bio_add_buffer(struct bio *bio, struct buffer_head *bh)
-{
-	return bio_add_page(bio, bh->b_page, bh->b_size, bh_offset(bh));
-}
-
 /*
  * Submit all of the bios for all of the ioends we have saved up, covering the
  * initial writepage page and also any probed pages.
@@ -443,6 +608,12 @@ static inline int bio_add_buffer(struct bio *bio, struct buffer_head *bh)
  *
  * The fix is two passes across the ioend list - one to start writeback on the
  * buffer_heads, and then submit them for I/O on the second pass.
+ *
+ * Bios are built from the ioend's buffer_heads for every block size.  They
+ * already span pages whenever the blocks are contiguous on disk; what stays
+ * is one buffer_head and one bio_add_page() call per page when the block
+ * size equals the page size.  Avoiding that needs block state tracked
+ * without buffer_heads from write_begin onwards, which this path does not do.
  */
 STATIC void
 xfs_submit_ioend(
@@ -450,9 +621,10 @@ xfs_submit_ioend(
 {
 	xfs_ioend_t		*head = ioend;
 	xfs_ioend_t		*next;
-	struct buffer_head	*bh;
+	struct buffer_head	*bh, *tail, *next_bh;
 	struct bio		*bio;
 	sector_t		lastblock = 0;
+	unsigned int		len;
 
 	/* Pass 1 - start writeback */
 	do {
@@ -468,7 +640,25 @@ xfs_submit_ioend(
 		next = ioend->io_list;
 		bio = NULL;
 
-		for (bh = ioend->io_buffer_head; bh; bh = bh->b_private) {
+		for (bh = ioend->io_buffer_head; bh; bh = next_bh) {
+			/*
+			 * Buffers that are adjacent both within the page
+			 * and on disk go into the bio as a single segment.
+			 * A bio_vec cannot span pages, so this only saves
+			 * anything when the block size is below the page
+			 * size; with one buffer per page each page is
+			 * still added on its own.
+			 */
+			len = bh->b_size;
+			for (tail = bh; (next_bh = tail->b_private) != NULL;
+			     tail = next_bh) {
+				if (next_bh->b_page != bh->b_page ||
+				    next_bh->b_blocknr != tail->b_blocknr + 1 ||
+				    bh_offset(next_bh) !=
+						bh_offset(tail) + tail->b_size)
+					break;
+				len += next_bh->b_size;
+			}
 
 			if (!bio) {
  retry:
@@ -478,12 +668,13 @@ xfs_submit_ioend(
 				goto retry;
 			}
 
-			if (bio_add_buffer(bio, bh) != bh->b_size) {
+			if (bio_add_page(bio, bh->b_page, len,
+					 bh_offset(bh)) != len) {
 				xfs_submit_ioend_bio(ioend, bio);
 				goto retry;
 			}
 
-			lastblock = bh->b_blocknr;
+			lastblock = tail->b_blocknr;
 		}
 		if (bio)
 			xfs_submit_ioend_bio(ioend, bio);
@@ -1247,13 +1438,34 @@ out_unlock:
 	return error;
 }
 
+/*
+ * Converting a delalloc buffer allocates the whole contiguous delalloc
+ * extent it sits in, and xfs_cluster_write() then follows that mapping
+ * to write out every page it covers - but only until wbc->nr_to_write
+ * runs out.  Dirty throttling and background writeback often ask for
+ * a few dozen pages at a time, which leaves freshly allocated extents
+ * written in many small I/Os spread out over time.  Give each call room
+ * for a decent sized cluster; the extra pages written are still
+ * accounted to the caller through nr_to_write.
+ */
+#define XFS_WRITEPAGES_MIN	((4 * 1024 * 1024) >> PAGE_CACHE_SHIFT)
+
 STATIC int
 xfs_vm_writepages(
 	struct address_space	*mapping,
 	struct writeback_control *wbc)
 {
+	long			bump = 0;
+	int			ret;
+
 	xfs_iflags_clear(XFS_I(mapping->host), XFS_ITRUNCATED);
-	return generic_writepages(mapping, wbc);
+	if (wbc->nr_to_write > 0 && wbc->nr_to_write < XFS_WRITEPAGES_MIN) {
+		bump = XFS_WRITEPAGES_MIN - wbc->nr_to_write;
+		wbc->nr_to_write += bump;
+	}
+	ret = generic_writepages(mapping, wbc);
+	wbc->nr_to_write -= bump;
+	return ret;
 }
 
 /*
@@ -1468,6 +1680,7 @@ xfs_end_io_direct(
 		 * didn't map an unwritten extent so switch it's completion
 		 * handler.
 		 */
+		ioend->io_type = IOMAP_NEW;
 		INIT_WORK(&ioend->io_work, xfs_end_bio_written);
 		xfs_finish_ioend(ioend, 0);
 	}
@@ -231,7 +231,7 @@ xfs_file_fsync(
 	int		datasync)
 {
 	xfs_iflags_clear(XFS_I(dentry->d_inode), XFS_ITRUNCATED);
-	return -xfs_fsync(XFS_I(dentry->d_inode));
+	return -xfs_fsync(XFS_I(dentry->d_inode), datasync);
 }
 
 #ifdef HAVE_DMAPI
@@ -251,6 +251,13 @@ xfs_vm_fault(
 }
 #endif /* HAVE_DMAPI */
 
+/*
+ * Upper bound on the readdir buffer estimate.  xfs_dir2_leaf_getdents()
+ * allocates its block map from the estimate, so keep that allocation
+ * small whatever readahead size the device advertises.
+ */
+#define XFS_READDIR_MAX_PAGES	64
+
 STATIC int
 xfs_file_readdir(
 	struct file	*filp,
@@ -259,6 +266,7 @@ xfs_file_readdir(
 {
 	struct inode	*inode = filp->f_path.dentry->d_inode;
 	xfs_inode_t	*ip = XFS_I(inode);
+	struct file_ra_state *ra = &filp->f_ra;
 	int		error;
 	size_t		bufsize;
 
@@ -273,11 +281,26 @@ xfs_file_readdir(
 	 * Try to give it an estimate that's good enough, maybe at some
 	 * point we can change the ->readdir prototype to include the
 	 * buffer size.
+	 *
+	 * A page is plenty for a single call, but a program listing a
+	 * huge directory from start to end then only ever has a block or
+	 * two in flight.  The directory's file readahead state is otherwise
+	 * unused, so keep a window in it: every call that carries on where
+	 * the last one stopped doubles the estimate, up to the readahead
+	 * size of the open file or XFS_READDIR_MAX_PAGES, whichever is
+	 * smaller, and any seek starts again at one page.
 	 */
-	bufsize = (size_t)min_t(loff_t, PAGE_SIZE, inode->i_size);
+	if (filp->f_pos && filp->f_pos == ra->prev_pos)
+		ra->size = max(min(min(ra->size * 2, ra->ra_pages),
+				   (unsigned int)XFS_READDIR_MAX_PAGES), 1U);
+	else
+		ra->size = 1;
+	bufsize = (size_t)min_t(loff_t, (loff_t)ra->size << PAGE_SHIFT,
+				inode->i_size);
 
 	error = xfs_readdir(ip, dirent, bufsize,
 				(xfs_off_t *)&filp->f_pos, filldir);
+	ra->prev_pos = filp->f_pos;
 	if (error)
 		return -error;
 	return 0;
@@ -394,7 +417,21 @@ xfs_vm_page_mkwrite(
 	struct vm_area_struct	*vma,
 	struct page		*page)
 {
-	return block_page_mkwrite(vma, page, xfs_get_blocks);
+	struct inode		*inode = vma->vm_file->f_path.dentry->d_inode;
+	struct xfs_inode	*ip = XFS_I(inode);
+	int			error;
+
+	error = block_page_mkwrite(vma, page, xfs_get_blocks);
+
+	/*
+	 * With lazytime, update the timestamps here as a lazy update.  The
+	 * fault's own file_update_time() still dirties the VFS inode, but
+	 * i_update_lazy lets background writeback leave it alone.
+	 */
+	if (!error && (ip->i_mount->m_flags & XFS_MOUNT_LAZYTIME))
+		xfs_ichgtime(ip, XFS_ICHGTIME_MOD | XFS_ICHGTIME_CHG |
+				 XFS_ICHGTIME_LAZY);
+	return error;
 }
 
 const struct file_operations xfs_file_operations = {
@@ -41,4 +41,10 @@ xfs_param_t xfs_params = {
 	.rotorstep	= {	1,		1,		255	},
 	.inherit_nodfrg	= {	0,		1,		1	},
 	.fstrm_timer	= {	1,		30*100,		3600*100},
+	.adapt_logcnt	= {	0,		0,		1	},
+	.eofb_timer	= {	1,		300*100,	3600*24*100},
+	.lazytime_timer	= {	1*100,		300*100,	3600*24*100},
+	.dir_hcache	= {	0,		8192,		1024*1024},
+	.dir_hcache_tot	= {	0,		256*1024,	16*1024*1024},
+	.attr_rcache	= {	0,		64*1024,	1024*1024},
 };
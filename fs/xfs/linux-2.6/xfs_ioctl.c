@@ -56,6 +56,8 @@
 #include <linux/mount.h>
 #include <linux/namei.h>
 #include <linux/pagemap.h>
+#include <linux/security.h>
+#include <linux/sort.h>
 
 /*
  * xfs_find_handle maps from userspace xfs_fsop_handlereq structure to
@@ -661,6 +663,187 @@ xfs_attrmulti_by_handle(
 	return -error;
 }
 
+typedef struct xfs_attrmulti_ent {
+	xfs_ino_t		ino;		/* inode number */
+	int			index;		/* position in the op array */
+} xfs_attrmulti_ent_t;
+
+/*
+ * Ops on the same inode stay in the order the caller gave them.
+ */
+STATIC int
+xfs_attrmulti_ent_cmp(
+	const void		*a,
+	const void		*b)
+{
+	const xfs_attrmulti_ent_t *ea = a;
+	const xfs_attrmulti_ent_t *eb = b;
+
+	if (ea->ino != eb->ino)
+		return ea->ino < eb->ino ? -1 : 1;
+	return ea->index - eb->index;
+}
+
+STATIC int
+xfs_attrmulti_ino_get(
+	xfs_mount_t		*mp,
+	xfs_attr_inoop_t	*op,
+	char			*attr_name)
+{
+	char			*kbuf;
+	int			len = op->ai_length;
+	int			error;
+
+	if (op->ai_length > XATTR_SIZE_MAX)
+		return EINVAL;
+	kbuf = kmalloc(len, GFP_KERNEL);
+	if (!kbuf)
+		return ENOMEM;
+
+	error = xfs_attr_get_by_ino(mp, op->ai_ino, attr_name, kbuf, &len,
+				    op->ai_flags);
+	op->ai_length = len;
+	if (!error && copy_to_user(op->ai_attrvalue, kbuf, len))
+		error = EFAULT;
+
+	kfree(kbuf);
+	return error;
+}
+
+STATIC int
+xfs_attrmulti_ino_modify(
+	xfs_mount_t		*mp,
+	struct file		*filp,
+	xfs_attr_inoop_t	*op,
+	char			*attr_name)
+{
+	xfs_inode_t		*ip;
+	int			error;
+
+	error = mnt_want_write(filp->f_path.mnt);
+	if (error)
+		return error;
+	error = xfs_iget(mp, NULL, op->ai_ino, XFS_IGET_BULKSTAT, 0, &ip, 0);
+	if (error)
+		goto out_drop_write;
+	if (op->ai_opcode == ATTR_OP_SET)
+		error = xfs_attrmulti_attr_set(VFS_I(ip), attr_name,
+				op->ai_attrvalue, op->ai_length, op->ai_flags);
+	else
+		error = xfs_attrmulti_attr_remove(VFS_I(ip), attr_name,
+				op->ai_flags);
+	IRELE(ip);
+ out_drop_write:
+	mnt_drop_write(filp->f_path.mnt);
+	return error;
+}
+
+/*
+ * Attribute get/set/remove on many inodes in one call, keyed by inode
+ * number as returned by bulkstat rather than by handle.
+ *
+ * The ops are run in inode number order after starting readahead on
+ * every inode cluster they touch.  Gets on inodes that are not in core
+ * and have shortform attributes are answered from the cluster buffer
+ * without instantiating the inode (see xfs_attr_get_by_ino).
+ */
+STATIC int
+xfs_attrmulti_by_ino(
+	xfs_mount_t		*mp,
+	void			__user *arg,
+	struct file		*filp)
+{
+	xfs_fsop_attrmulti_inoreq_t am_ireq;
+	xfs_attr_inoop_t	*ops, *op;
+	xfs_attrmulti_ent_t	*ents;
+	struct xfs_imap		imap;
+	xfs_daddr_t		lastblkno = -1;
+	unsigned int		i, size;
+	char			*attr_name;
+	int			len;
+	int			error;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -XFS_ERROR(EPERM);
+	if (XFS_FORCED_SHUTDOWN(mp))
+		return -XFS_ERROR(EIO);
+	if (copy_from_user(&am_ireq, arg, sizeof(xfs_fsop_attrmulti_inoreq_t)))
+		return -XFS_ERROR(EFAULT);
+
+	if (!am_ireq.opcount ||
+	    am_ireq.opcount > 16 * PAGE_SIZE / sizeof(xfs_attr_inoop_t))
+		return -XFS_ERROR(E2BIG);
+	size = am_ireq.opcount * sizeof(xfs_attr_inoop_t);
+
+	error = ENOMEM;
+	ops = kmalloc(size, GFP_KERNEL);
+	if (!ops)
+		goto out;
+
+	error = EFAULT;
+	if (copy_from_user(ops, am_ireq.ops, size))
+		goto out_kfree_ops;
+
+	error = ENOMEM;
+	ents = kmalloc(am_ireq.opcount * sizeof(*ents), GFP_KERNEL);
+	if (!ents)
+		goto out_kfree_ops;
+	attr_name = kmalloc(MAXNAMELEN, GFP_KERNEL);
+	if (!attr_name)
+		goto out_kfree_ents;
+
+	for (i = 0; i < am_ireq.opcount; i++) {
+		ents[i].ino = ops[i].ai_ino;
+		ents[i].index = i;
+	}
+	sort(ents, am_ireq.opcount, sizeof(*ents), xfs_attrmulti_ent_cmp, NULL);
+	for (i = 0; i < am_ireq.opcount; i++) {
+		if (xfs_imap(mp, NULL, ents[i].ino, &imap, XFS_IGET_BULKSTAT) ||
+		    imap.im_blkno == lastblkno)
+			continue;
+		xfs_baread(mp->m_ddev_targp, imap.im_blkno, imap.im_len);
+		lastblkno = imap.im_blkno;
+	}
+
+	error = 0;
+	for (i = 0; i < am_ireq.opcount; i++) {
+		op = &ops[ents[i].index];
+		len = strncpy_from_user(attr_name, op->ai_attrname, MAXNAMELEN);
+		if (len < 0) {
+			op->ai_error = EFAULT;
+			continue;
+		}
+		if (len == 0 || len == MAXNAMELEN) {
+			op->ai_error = ERANGE;
+			continue;
+		}
+
+		switch (op->ai_opcode) {
+		case ATTR_OP_GET:
+			op->ai_error = xfs_attrmulti_ino_get(mp, op, attr_name);
+			break;
+		case ATTR_OP_SET:
+		case ATTR_OP_REMOVE:
+			op->ai_error = xfs_attrmulti_ino_modify(mp, filp, op,
+					attr_name);
+			break;
+		default:
+			op->ai_error = EINVAL;
+		}
+	}
+
+	if (copy_to_user(am_ireq.ops, ops, size))
+		error = XFS_ERROR(EFAULT);
+
+	kfree(attr_name);
+ out_kfree_ents:
+	kfree(ents);
+ out_kfree_ops:
+	kfree(ops);
+ out:
+	return -error;
+}
+
 STATIC int
 xfs_ioc_space(
 	struct xfs_inode	*ip,
@@ -755,6 +938,206 @@ xfs_ioc_bulkstat(
 	return 0;
 }
 
+/*
+ * Entries returned by one XFS_IOC_READDIRPLUS call at most.
+ */
+#define XFS_READDIRPLUS_MAX	4096
+
+typedef struct xfs_readdirplus_ent {
+	xfs_ino_t		ino;		/* inode number */
+	int			index;		/* position in user buffer */
+} xfs_readdirplus_ent_t;
+
+typedef struct xfs_readdirplus_ctx {
+	xfs_direntplus_t	__user *ubuffer;
+	xfs_readdirplus_ent_t	*ents;
+	int			count;
+	int			max;
+	int			error;
+} xfs_readdirplus_ctx_t;
+
+STATIC int
+xfs_readdirplus_fill(
+	void			*private,
+	const char		*name,
+	int			namelen,
+	loff_t			offset,
+	u64			ino,
+	unsigned int		type)
+{
+	xfs_readdirplus_ctx_t	*ctx = private;
+	xfs_direntplus_t	__user *ude;
+
+	if (ctx->count == ctx->max)
+		return -ENOSPC;
+	ude = &ctx->ubuffer[ctx->count];
+	if (copy_to_user(ude->de_name, name, namelen) ||
+	    put_user(0, &ude->de_name[namelen]) ||
+	    put_user(namelen, &ude->de_namelen) ||
+	    put_user(offset, &ude->de_off) ||
+	    put_user(ino, &ude->de_ino)) {
+		ctx->error = EFAULT;
+		return -EFAULT;
+	}
+	ctx->ents[ctx->count].ino = ino;
+	ctx->ents[ctx->count].index = ctx->count;
+	ctx->count++;
+	return 0;
+}
+
+STATIC int
+xfs_readdirplus_cmp(
+	const void		*a,
+	const void		*b)
+{
+	xfs_ino_t		ia = ((xfs_readdirplus_ent_t *)a)->ino;
+	xfs_ino_t		ib = ((xfs_readdirplus_ent_t *)b)->ino;
+
+	return ia < ib ? -1 : ia > ib;
+}
+
+/*
+ * Bulkstat formatter for callers without CAP_SYS_ADMIN: the generation
+ * number and DMAPI state are only handed out through the handle and
+ * bulkstat interfaces, which need that capability.
+ */
+STATIC int
+xfs_readdirplus_fmt(
+	void			__user *ubuffer,
+	const xfs_bstat_t	*buffer)
+{
+	xfs_bstat_t		bstat = *buffer;
+
+	bstat.bs_gen = 0;
+	bstat.bs_dmevmask = 0;
+	bstat.bs_dmstate = 0;
+	if (copy_to_user(ubuffer, &bstat, sizeof(bstat)))
+		return -EFAULT;
+	return sizeof(bstat);
+}
+
+/*
+ * Return a batch of directory entries together with the bulkstat data
+ * of the inodes they point to, saving a stat call per entry.
+ *
+ * The names are read under the directory i_mutex like readdir does.  The
+ * inodes are then looked at in inode number order, which is disk order,
+ * after starting readahead on all of their inode clusters, so that the
+ * inode reads go out as one ascending stream instead of one random read
+ * per entry.
+ *
+ * The i_mutex stays held until every inode has been stat'ed.  Nothing can
+ * be unlinked from or renamed out of the directory meanwhile, so each
+ * inode number still belongs to the name returned with it, and its inode
+ * cannot have been freed and reused by a file the caller has no path to.
+ */
+STATIC int
+xfs_ioc_readdirplus(
+	xfs_inode_t		*dp,
+	struct file		*filp,
+	void			__user *arg)
+{
+	struct inode		*inode = filp->f_path.dentry->d_inode;
+	xfs_mount_t		*mp = dp->i_mount;
+	xfs_fsop_readdirplus_t	rdp;
+	xfs_readdirplus_ctx_t	ctx;
+	xfs_readdirplus_ent_t	*ent;
+	struct xfs_imap		imap;
+	xfs_daddr_t		lastblkno = -1;
+	xfs_off_t		offset;
+	bulkstat_one_fmt_pf	formatter = NULL;
+	int			stat;
+	int			error;
+	int			i;
+
+	if (!S_ISDIR(inode->i_mode))
+		return -ENOTDIR;
+	if (!(filp->f_mode & FMODE_READ))
+		return -EBADF;
+	if (XFS_FORCED_SHUTDOWN(mp))
+		return -XFS_ERROR(EIO);
+	error = inode_permission(inode, MAY_EXEC);
+	if (error)
+		return error;
+	error = security_file_permission(filp, MAY_READ);
+	if (error)
+		return error;
+	if (!capable(CAP_SYS_ADMIN))
+		formatter = xfs_readdirplus_fmt;
+
+	if (copy_from_user(&rdp, arg, sizeof(rdp)))
+		return -XFS_ERROR(EFAULT);
+	if (rdp.icount <= 0 || rdp.ubuffer == NULL)
+		return -XFS_ERROR(EINVAL);
+
+	ctx.ubuffer = rdp.ubuffer;
+	ctx.max = min(rdp.icount, XFS_READDIRPLUS_MAX);
+	ctx.count = 0;
+	ctx.error = 0;
+	ctx.ents = kmem_alloc(ctx.max * sizeof(*ctx.ents), KM_SLEEP | KM_LARGE);
+
+	/*
+	 * Collect the names, copying them out as we go.
+	 */
+	mutex_lock(&inode->i_mutex);
+	if (IS_DEADDIR(inode)) {
+		error = ENOENT;
+		goto out_unlock;
+	}
+	offset = rdp.offset;
+	error = xfs_readdir(dp, &ctx,
+			(size_t)min_t(loff_t, ctx.max * 32, inode->i_size),
+			&offset, xfs_readdirplus_fill);
+	file_accessed(filp);
+	if (!error)
+		error = ctx.error;
+	if (error)
+		goto out_unlock;
+
+	/*
+	 * Sort by inode number and read ahead each inode cluster once.
+	 */
+	sort(ctx.ents, ctx.count, sizeof(*ctx.ents), xfs_readdirplus_cmp, NULL);
+	for (i = 0, ent = ctx.ents; i < ctx.count; i++, ent++) {
+		if (xfs_imap(mp, NULL, ent->ino, &imap, 0) ||
+		    imap.im_blkno == lastblkno)
+			continue;
+		xfs_baread(mp->m_ddev_targp, imap.im_blkno, imap.im_len);
+		lastblkno = imap.im_blkno;
+	}
+
+	/*
+	 * Then fill in the stat data, still in inode number order.
+	 */
+	for (i = 0, ent = ctx.ents; i < ctx.count; i++, ent++) {
+		xfs_direntplus_t __user *ude = &rdp.ubuffer[ent->index];
+
+		error = xfs_bulkstat_one(mp, ent->ino, &ude->de_stat,
+				sizeof(xfs_bstat_t), (void *)formatter, 0, NULL,
+				NULL, &stat);
+		if (stat == BULKSTAT_RV_DIDONE)
+			error = 0;
+		else if (error == EFAULT)
+			goto out_unlock;
+		if (put_user(error, &ude->de_error)) {
+			error = EFAULT;
+			goto out_unlock;
+		}
+	}
+	error = 0;
+ out_unlock:
+	mutex_unlock(&inode->i_mutex);
+
+	if (!error) {
+		rdp.offset = offset;
+		rdp.ocount = ctx.count;
+		if (copy_to_user(arg, &rdp, sizeof(rdp)))
+			error = EFAULT;
+	}
+	kmem_free(ctx.ents);
+	return -XFS_ERROR(error);
+}
+
 STATIC int
 xfs_ioc_fsgeometry_v1(
 	xfs_mount_t		*mp,
@@ -1386,6 +1769,9 @@ xfs_ioctl(
 	case XFS_IOC_FSINUMBERS:
 		return xfs_ioc_bulkstat(mp, cmd, arg);
 
+	case XFS_IOC_READDIRPLUS:
+		return xfs_ioc_readdirplus(ip, filp, arg);
+
 	case XFS_IOC_FSGEOMETRY_V1:
 		return xfs_ioc_fsgeometry_v1(mp, arg);
 
@@ -1444,6 +1830,9 @@ xfs_ioctl(
 	case XFS_IOC_ATTRMULTI_BY_HANDLE:
 		return xfs_attrmulti_by_handle(mp, arg, filp, inode);
 
+	case XFS_IOC_ATTRMULTI_BY_INO:
+		return xfs_attrmulti_by_ino(mp, arg, filp);
+
 	case XFS_IOC_SWAPEXT: {
 		error = xfs_swapext((struct xfs_swapext __user *)arg);
 		return -error;
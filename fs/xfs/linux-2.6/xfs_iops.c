@@ -125,11 +125,22 @@ xfs_ichgtime(
 	 * while doing this.  We use the SYNCHRONIZE macro to
 	 * ensure that the compiler does not reorder the update
 	 * of i_update_core above the timestamp updates above.
+	 *
+	 * With lazytime, a data path update on an otherwise clean core
+	 * is remembered in i_update_lazy so that background writeback
+	 * can leave it alone.  Any other update clears it again.
 	 */
 	if (sync_it) {
 		SYNCHRONIZE();
+		if ((flags & XFS_ICHGTIME_LAZY) &&
+		    (ip->i_mount->m_flags & XFS_MOUNT_LAZYTIME)) {
+			if (!ip->i_update_core)
+				ip->i_update_lazy = 1;
+		} else {
+			ip->i_update_lazy = 0;
+			xfs_mark_inode_dirty_sync(ip);
+		}
 		ip->i_update_core = 1;
-		xfs_mark_inode_dirty_sync(ip);
 	}
 }
 
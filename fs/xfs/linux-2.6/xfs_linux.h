@@ -72,6 +72,7 @@
 #include <linux/random.h>
 #include <linux/ctype.h>
 #include <linux/writeback.h>
+#include <linux/hash.h>
 
 #include <asm/page.h>
 #include <asm/div64.h>
@@ -121,6 +122,12 @@
 #define xfs_rotorstep		xfs_params.rotorstep.val
 #define xfs_inherit_nodefrag	xfs_params.inherit_nodfrg.val
 #define xfs_fstrm_centisecs	xfs_params.fstrm_timer.val
+#define xfs_adapt_logcount	xfs_params.adapt_logcnt.val
+#define xfs_eofb_centisecs	xfs_params.eofb_timer.val
+#define xfs_lazytime_centisecs	xfs_params.lazytime_timer.val
+#define xfs_dir_hcache_entries	xfs_params.dir_hcache.val
+#define xfs_dir_hcache_total	xfs_params.dir_hcache_tot.val
+#define xfs_attr_rcache_bytes	xfs_params.attr_rcache.val
 
 #define current_cpu()		(raw_smp_processor_id())
 #define current_pid()		(current->pid)
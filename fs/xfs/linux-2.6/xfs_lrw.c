@@ -53,6 +53,8 @@
 #include <linux/capability.h>
 #include <linux/mount.h>
 #include <linux/writeback.h>
+#include <linux/pipe_fs_i.h>
+#include <linux/splice.h>
 
 
 #if defined(XFS_RW_TRACE)
@@ -306,6 +308,154 @@ xfs_splice_read(
 	return ret;
 }
 
+/*
+ * Only two kinds of stolen pages can go into the page cache as they are:
+ * pages a pipe write allocated, which are on no LRU list yet, and page
+ * cache pages of a regular file that page_cache_pipe_buf_steal() took
+ * out of their mapping, which stay on the file LRU.  Anything swap
+ * backed (tmpfs and shmem pages, which sit on the anon LRU), anonymous,
+ * still mapped or still attached to something is copied instead.
+ */
+STATIC int
+xfs_pipe_page_movable(
+	struct pipe_buffer	*buf,
+	struct page		*page)
+{
+	if (page->mapping || PagePrivate(page) || PageAnon(page) ||
+	    PageSwapBacked(page) || page_mapped(page))
+		return 0;
+	if (buf->flags & PIPE_BUF_FLAG_LRU)
+		return PageLRU(page);
+	return !PageLRU(page);
+}
+
+/*
+ * Splice actor for SPLICE_F_MOVE writes.  A pipe buffer holding a
+ * whole page, bound for a page aligned file offset with no page cache
+ * page behind it yet, is stolen from the pipe and inserted into the
+ * mapping as it is rather than copied into a newly allocated page.
+ * Partial pages, and pages the pipe will not give up, are copied by
+ * pipe_to_file() as usual.
+ */
+STATIC int
+xfs_pipe_to_file(
+	struct pipe_inode_info	*pipe,
+	struct pipe_buffer	*buf,
+	struct splice_desc	*sd)
+{
+	struct file		*file = sd->u.file;
+	struct address_space	*mapping = file->f_mapping;
+	struct page		*page = buf->page;
+	int			error;
+
+	if ((sd->pos & ~PAGE_CACHE_MASK) || buf->offset ||
+	    sd->len != PAGE_CACHE_SIZE || mapping_mapped(mapping))
+		return pipe_to_file(pipe, buf, sd);
+
+	error = buf->ops->confirm(pipe, buf);
+	if (unlikely(error))
+		return error;
+
+	/*
+	 * A successful steal hands the page back to us locked, which is
+	 * what add_to_page_cache_locked() wants.  If someone beat us to
+	 * the page cache slot, just copy into their page.
+	 */
+	if (buf->ops->steal(pipe, buf))
+		return pipe_to_file(pipe, buf, sd);
+	if (!xfs_pipe_page_movable(buf, page) ||
+	    add_to_page_cache_locked(page, mapping,
+			sd->pos >> PAGE_CACHE_SHIFT, GFP_KERNEL)) {
+		unlock_page(page);
+		return pipe_to_file(pipe, buf, sd);
+	}
+	if (!(buf->flags & PIPE_BUF_FLAG_LRU))
+		lru_cache_add_file(page);
+
+	/*
+	 * The page cache now holds its own reference, take another one
+	 * for generic_write_end() to drop just like a page handed out by
+	 * write_begin.  The whole page is being written, so mapping the
+	 * buffers never reads anything in.
+	 */
+	page_cache_get(page);
+	error = block_prepare_write(page, 0, PAGE_CACHE_SIZE, xfs_get_blocks);
+	if (unlikely(error)) {
+		ClearPageUptodate(page);
+		unlock_page(page);
+		page_cache_release(page);
+		return error;
+	}
+	return generic_write_end(file, mapping, sd->pos, sd->len, sd->len,
+				 page, NULL);
+}
+
+/*
+ * SPLICE_F_MOVE variant of generic_file_splice_write().
+ */
+STATIC ssize_t
+xfs_splice_write_move(
+	struct pipe_inode_info	*pipe,
+	struct file		*outfilp,
+	loff_t			*ppos,
+	size_t			count,
+	int			flags)
+{
+	struct address_space	*mapping = outfilp->f_mapping;
+	struct inode		*inode = mapping->host;
+	struct splice_desc	sd = {
+		.total_len	= count,
+		.flags		= flags,
+		.pos		= *ppos,
+		.u.file		= outfilp,
+	};
+	ssize_t			ret;
+
+	inode_double_lock(inode, pipe->inode);
+	ret = file_remove_suid(outfilp);
+	if (likely(!ret))
+		ret = __splice_from_pipe(pipe, &sd, xfs_pipe_to_file);
+	inode_double_unlock(inode, pipe->inode);
+	if (ret > 0) {
+		*ppos += ret;
+		balance_dirty_pages_ratelimited_nr(mapping,
+			(ret + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT);
+	}
+	return ret;
+}
+
+/*
+ * Reserve delayed allocation blocks for an appending splice up front,
+ * so that the per-page block mapping done while splicing only finds
+ * existing delalloc extents instead of each page making its own
+ * reservation.  Whatever the splice does not end up filling is left
+ * beyond EOF, where it is trimmed like any other speculative
+ * preallocation.
+ */
+STATIC void
+xfs_splice_reserve(
+	xfs_inode_t		*ip,
+	xfs_off_t		offset,
+	size_t			count)
+{
+	xfs_iomap_t		iomap;
+	int			niomaps;
+	size_t			len;
+
+	while (count) {
+		niomaps = 1;
+		if (xfs_iomap(ip, offset, count, BMAPI_WRITE,
+				&iomap, &niomaps) || !niomaps)
+			break;
+		len = iomap.iomap_bsize - iomap.iomap_delta;
+		if (len >= count)
+			break;
+		offset += len;
+		count -= len;
+	}
+	xfs_inode_set_eofblocks_tag(ip);
+}
+
 ssize_t
 xfs_splice_write(
 	xfs_inode_t		*ip,
@@ -348,7 +498,16 @@ xfs_splice_write(
 
 	xfs_rw_enter_trace(XFS_SPLICE_WRITE_ENTER, ip,
 			   pipe, count, *ppos, ioflags);
-	ret = generic_file_splice_write(pipe, outfilp, ppos, count, flags);
+	if ((flags & SPLICE_F_MOVE) && count >= PAGE_CACHE_SIZE &&
+	    !(outfilp->f_flags & O_SYNC) && !IS_SYNC(inode) &&
+	    !XFS_IS_REALTIME_INODE(ip)) {
+		if (*ppos >= ip->i_size)
+			xfs_splice_reserve(ip, *ppos, count);
+		ret = xfs_splice_write_move(pipe, outfilp, ppos, count, flags);
+	} else {
+		ret = generic_file_splice_write(pipe, outfilp, ppos, count,
+						flags);
+	}
 	if (ret > 0)
 		XFS_STATS_ADD(xs_write_bytes, ret);
 
@@ -556,6 +715,77 @@ out_lock:
 	return error;
 }
 
+/*
+ * Check whether extending the file from isize to offset would leave
+ * xfs_zero_eof() anything to do.  If the block holding the old EOF is a
+ * hole, or EOF is block aligned, and everything from there up to offset
+ * is a hole or unwritten, nothing needs zeroing and a direct write can
+ * extend the file while holding the iolock shared.
+ */
+STATIC int
+xfs_zero_eof_needed(
+	xfs_inode_t	*ip,
+	xfs_off_t	offset,		/* starting I/O offset */
+	xfs_fsize_t	isize)		/* current inode size */
+{
+	xfs_mount_t	*mp = ip->i_mount;
+	xfs_fileoff_t	last_fsb;
+	xfs_fileoff_t	start_fsb;
+	xfs_fileoff_t	end_fsb;
+	int		nimaps;
+	xfs_bmbt_irec_t	imap;
+
+	ASSERT(xfs_isilocked(ip, XFS_ILOCK_EXCL));
+	ASSERT(offset > isize);
+
+	if (XFS_IS_REALTIME_INODE(ip))
+		return 1;
+
+	last_fsb = XFS_B_TO_FSBT(mp, isize);
+	start_fsb = last_fsb;
+	end_fsb = XFS_B_TO_FSB(mp, offset);
+	while (start_fsb < end_fsb) {
+		nimaps = 1;
+		if (xfs_bmapi(NULL, ip, start_fsb, end_fsb - start_fsb, 0,
+				NULL, 0, &imap, &nimaps, NULL, NULL) ||
+		    nimaps < 1)
+			return 1;
+
+		if (imap.br_startblock != HOLESTARTBLOCK) {
+			if (imap.br_state != XFS_EXT_UNWRITTEN)
+				return 1;
+			/* a partial EOF block is zeroed even if unwritten */
+			if (imap.br_startoff == last_fsb &&
+			    XFS_B_FSB_OFFSET(mp, isize))
+				return 1;
+		}
+		start_fsb = imap.br_startoff + imap.br_blockcount;
+	}
+	return 0;
+}
+
+/*
+ * Drop a writer's claim on i_new_size.  Several direct writers can be
+ * extending the file at once under a shared iolock, so the intended size
+ * is only cleared when the last of them finishes.  If a direct or
+ * synchronous write failed (such as ENOSPC), part of it may have reached
+ * disk and pushed the on-disk size beyond the in-memory size, so trim
+ * that back here as well.
+ */
+STATIC void
+xfs_write_end_extend(
+	xfs_inode_t	*ip)
+{
+	xfs_ilock(ip, XFS_ILOCK_EXCL);
+	ASSERT(ip->i_new_size_users > 0);
+	if (--ip->i_new_size_users == 0) {
+		ip->i_new_size = 0;
+		if (ip->i_d.di_size > ip->i_size)
+			ip->i_d.di_size = ip->i_size;
+	}
+	xfs_iunlock(ip, XFS_ILOCK_EXCL);
+}
+
 ssize_t				/* bytes written, or (-) error */
 xfs_write(
 	struct xfs_inode	*xip,
@@ -577,6 +807,7 @@ xfs_write(
 	size_t			ocount = 0, count;
 	loff_t			pos;
 	int			need_i_mutex;
+	int			extending = 0;
 
 	XFS_STATS_INC(xs_write_calls);
 
@@ -614,6 +845,8 @@ start:
 					S_ISBLK(inode->i_mode));
 	if (error) {
 		xfs_iunlock(xip, XFS_ILOCK_EXCL|iolock);
+		if (extending)
+			xfs_write_end_extend(xip);
 		goto out_unlock_mutex;
 	}
 
@@ -654,7 +887,17 @@ start:
 			return XFS_ERROR(-EINVAL);
 		}
 
-		if (!need_i_mutex && (mapping->nrpages || pos > xip->i_size)) {
+		/*
+		 * Cached pages have to be flushed and invalidated under the
+		 * exclusive iolock, as does any zeroing between the current
+		 * EOF and the start of this write.  Extending writes that
+		 * leave nothing to zero run concurrently; the on-disk size
+		 * is updated at I/O completion.
+		 */
+		if (!need_i_mutex &&
+		    (mapping->nrpages ||
+		     (pos > xip->i_size &&
+		      xfs_zero_eof_needed(xip, pos, xip->i_size)))) {
 			xfs_iunlock(xip, XFS_ILOCK_EXCL|iolock);
 			iolock = XFS_IOLOCK_EXCL;
 			need_i_mutex = 1;
@@ -665,8 +908,14 @@ start:
 	}
 
 	new_size = pos + count;
-	if (new_size > xip->i_size)
-		xip->i_new_size = new_size;
+	if (new_size > xip->i_size) {
+		if (new_size > xip->i_new_size)
+			xip->i_new_size = new_size;
+		if (!extending) {
+			xip->i_new_size_users++;
+			extending = 1;
+		}
+	}
 
 	/*
 	 * We're not supposed to change timestamps in readonly-mounted
@@ -674,7 +923,8 @@ start:
 	 */
 	if (likely(!(ioflags & IO_INVIS) &&
 		   !mnt_want_write(file->f_path.mnt))) {
-		xfs_ichgtime(xip, XFS_ICHGTIME_MOD | XFS_ICHGTIME_CHG);
+		xfs_ichgtime(xip, XFS_ICHGTIME_MOD | XFS_ICHGTIME_CHG |
+				  XFS_ICHGTIME_LAZY);
 		mnt_drop_write(file->f_path.mnt);
 	}
 
@@ -687,7 +937,7 @@ start:
 	 * to zero it out up to the new size.
 	 */
 
-	if (pos > xip->i_size) {
+	if (pos > xip->i_size && need_i_mutex) {
 		error = xfs_zero_eof(xip, pos, xip->i_size);
 		if (error) {
 			xfs_iunlock(xip, XFS_ILOCK_EXCL);
@@ -825,20 +1075,8 @@ retry:
 	}
 
  out_unlock_internal:
-	if (xip->i_new_size) {
-		xfs_ilock(xip, XFS_ILOCK_EXCL);
-		xip->i_new_size = 0;
-		/*
-		 * If this was a direct or synchronous I/O that failed (such
-		 * as ENOSPC) then part of the I/O may have been written to
-		 * disk before the error occured.  In this case the on-disk
-		 * file size may have been adjusted beyond the in-memory file
-		 * size and now needs to be truncated back.
-		 */
-		if (xip->i_d.di_size > xip->i_size)
-			xip->i_d.di_size = xip->i_size;
-		xfs_iunlock(xip, XFS_ILOCK_EXCL);
-	}
+	if (extending)
+		xfs_write_end_extend(xip);
 	xfs_iunlock(xip, iolock);
  out_unlock_mutex:
 	if (need_i_mutex)
@@ -57,6 +57,10 @@ xfs_read_xfsstats(
 		{ "abtc2",		XFSSTAT_END_ABTC_V2		},
 		{ "bmbt2",		XFSSTAT_END_BMBT_V2		},
 		{ "ibt2",		XFSSTAT_END_IBT_V2		},
+		{ "iomapc",		XFSSTAT_END_IOMAP_CACHE		},
+		{ "dirhc",		XFSSTAT_END_DIR_HCACHE		},
+		{ "inline",		XFSSTAT_END_INLINE		},
+		{ "attrrc",		XFSSTAT_END_ATTR_RCACHE		},
 	};
 
 	/* Loop over all stats groups */
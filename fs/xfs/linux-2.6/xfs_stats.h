@@ -183,6 +183,19 @@ struct xfsstats {
 	__uint32_t		xs_ibt_2_alloc;
 	__uint32_t		xs_ibt_2_free;
 	__uint32_t		xs_ibt_2_moves;
+#define XFSSTAT_END_IOMAP_CACHE		(XFSSTAT_END_IBT_V2+2)
+	__uint32_t		xs_iomapc_hit;
+	__uint32_t		xs_iomapc_miss;
+#define XFSSTAT_END_DIR_HCACHE		(XFSSTAT_END_IOMAP_CACHE+2)
+	__uint32_t		xs_dir_hcache_hit;
+	__uint32_t		xs_dir_hcache_miss;
+#define XFSSTAT_END_INLINE		(XFSSTAT_END_DIR_HCACHE+3)
+	__uint32_t		xs_dir_sf_to_block;
+	__uint32_t		xs_attr_sf_to_leaf;
+	__uint32_t		xs_forkoff_grow;
+#define XFSSTAT_END_ATTR_RCACHE		(XFSSTAT_END_INLINE+2)
+	__uint32_t		xs_attr_rcache_hit;
+	__uint32_t		xs_attr_rcache_miss;
 /* Extra precision counters */
 	__uint64_t		xs_xstrat_bytes;
 	__uint64_t		xs_write_bytes;
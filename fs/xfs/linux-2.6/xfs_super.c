@@ -105,6 +105,8 @@ mempool_t *xfs_ioend_pool;
 #define MNTOPT_ATTR2	"attr2"		/* do use attr2 attribute format */
 #define MNTOPT_NOATTR2	"noattr2"	/* do not use attr2 attribute format */
 #define MNTOPT_FILESTREAM  "filestreams" /* use filestreams allocator */
+#define MNTOPT_LAZYTIME    "lazytime"	/* write back data timestamps lazily */
+#define MNTOPT_NOLAZYTIME  "nolazytime"	/* .. disable */
 #define MNTOPT_QUOTA	"quota"		/* disk quotas (user) */
 #define MNTOPT_NOQUOTA	"noquota"	/* no quotas */
 #define MNTOPT_USRQUOTA	"usrquota"	/* user quota enabled */
@@ -351,6 +353,10 @@ xfs_parseargs(
 			mp->m_flags |= XFS_MOUNT_NOATTR2;
 		} else if (!strcmp(this_char, MNTOPT_FILESTREAM)) {
 			mp->m_flags |= XFS_MOUNT_FILESTREAMS;
+		} else if (!strcmp(this_char, MNTOPT_LAZYTIME)) {
+			mp->m_flags |= XFS_MOUNT_LAZYTIME;
+		} else if (!strcmp(this_char, MNTOPT_NOLAZYTIME)) {
+			mp->m_flags &= ~XFS_MOUNT_LAZYTIME;
 		} else if (!strcmp(this_char, MNTOPT_NOQUOTA)) {
 			mp->m_qflags &= ~(XFS_UQUOTA_ACCT | XFS_UQUOTA_ACTIVE |
 					  XFS_GQUOTA_ACCT | XFS_GQUOTA_ACTIVE |
@@ -537,6 +543,7 @@ xfs_showargs(
 		{ XFS_MOUNT_OSYNCISOSYNC,	"," MNTOPT_OSYNCISOSYNC },
 		{ XFS_MOUNT_ATTR2,		"," MNTOPT_ATTR2 },
 		{ XFS_MOUNT_FILESTREAMS,	"," MNTOPT_FILESTREAM },
+		{ XFS_MOUNT_LAZYTIME,		"," MNTOPT_LAZYTIME },
 		{ XFS_MOUNT_DMAPI,		"," MNTOPT_DMAPI },
 		{ XFS_MOUNT_GRPID,		"," MNTOPT_GRPID },
 		{ 0, NULL }
@@ -964,6 +971,7 @@ xfs_fs_inode_init_once(
 	atomic_set(&ip->i_iocount, 0);
 	atomic_set(&ip->i_pincount, 0);
 	spin_lock_init(&ip->i_flags_lock);
+	seqlock_init(&ip->i_rmap_lock);
 	init_waitqueue_head(&ip->i_ipin_wait);
 	/*
 	 * Because we want to use a counting completion, complete
@@ -994,6 +1002,16 @@ xfs_fs_write_inode(
 	int			flags = 0;
 
 	xfs_itrace_entry(ip);
+
+	/*
+	 * With lazytime, background writeback leaves an inode whose only
+	 * unlogged change is a data path timestamp update to the periodic
+	 * flush in xfssyncd, fsync, or reclaim.  Explicit timestamp changes
+	 * such as utimes() clear i_update_lazy and are written as usual.
+	 */
+	if (!sync && ip->i_update_lazy)
+		return 0;
+
 	if (sync) {
 		error = xfs_wait_on_pages(ip, 0, -1);
 		if (error)
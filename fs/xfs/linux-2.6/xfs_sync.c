@@ -482,6 +482,17 @@ xfs_sync_worker(
 		error = xfs_sync_fsdata(mp, SYNC_BDFLUSH);
 		if (xfs_log_need_covered(mp))
 			error = xfs_commit_dummy_trans(mp, XFS_LOG_FORCE);
+		if (time_after(jiffies, mp->m_eofb_stamp +
+				xfs_eofb_centisecs * msecs_to_jiffies(10))) {
+			xfs_free_eofblocks_all(mp);
+			mp->m_eofb_stamp = jiffies;
+		}
+		if ((mp->m_flags & XFS_MOUNT_LAZYTIME) &&
+		    time_after(jiffies, mp->m_lazytime_stamp +
+				xfs_lazytime_centisecs * msecs_to_jiffies(10))) {
+			error = xfs_sync_inodes(mp, SYNC_ATTR);
+			mp->m_lazytime_stamp = jiffies;
+		}
 	}
 	mp->m_sync_seq++;
 	wake_up(&mp->m_wait_single_sync_task);
@@ -541,6 +552,8 @@ xfs_syncd_init(
 {
 	mp->m_sync_work.w_syncer = xfs_sync_worker;
 	mp->m_sync_work.w_mount = mp;
+	mp->m_eofb_stamp = jiffies;
+	mp->m_lazytime_stamp = jiffies;
 	mp->m_sync_task = kthread_run(xfssyncd, mp, "xfssyncd");
 	if (IS_ERR(mp->m_sync_task))
 		return -PTR_ERR(mp->m_sync_task);
@@ -761,4 +774,146 @@ xfs_reclaim_inodes(
 	return 0;
 }
 
+/*
+ * Speculative preallocation beyond EOF is normally trimmed on last close,
+ * but files that stay open (logs, media streams) can hold on to it for a
+ * long time.  Inodes with such blocks are tagged in the inode radix tree
+ * so that xfssyncd can find them cheaply and trim the ones that have
+ * gone idle.  XFS_IEOFRECENT is set each time the preallocation is
+ * extended and cleared by the scan, so an inode is only trimmed once it
+ * has seen no new preallocation for a full scan interval.
+ */
+void
+xfs_inode_set_eofblocks_tag(
+	xfs_inode_t	*ip)
+{
+	xfs_mount_t	*mp = ip->i_mount;
+	xfs_perag_t	*pag;
+
+	if (xfs_iflags_test(ip, XFS_IEOFBLOCKS)) {
+		if (!xfs_iflags_test(ip, XFS_IEOFRECENT))
+			xfs_iflags_set(ip, XFS_IEOFRECENT);
+		return;
+	}
+
+	pag = xfs_get_perag(mp, ip->i_ino);
+	read_lock(&pag->pag_ici_lock);
+	spin_lock(&ip->i_flags_lock);
+	radix_tree_tag_set(&pag->pag_ici_root,
+			XFS_INO_TO_AGINO(mp, ip->i_ino), XFS_ICI_EOFBLOCKS_TAG);
+	__xfs_iflags_set(ip, XFS_IEOFBLOCKS | XFS_IEOFRECENT);
+	spin_unlock(&ip->i_flags_lock);
+	read_unlock(&pag->pag_ici_lock);
+	xfs_put_perag(mp, pag);
+}
+
+void
+xfs_inode_clear_eofblocks_tag(
+	xfs_inode_t	*ip)
+{
+	xfs_mount_t	*mp = ip->i_mount;
+	xfs_perag_t	*pag = xfs_get_perag(mp, ip->i_ino);
+
+	read_lock(&pag->pag_ici_lock);
+	spin_lock(&ip->i_flags_lock);
+	radix_tree_tag_clear(&pag->pag_ici_root,
+			XFS_INO_TO_AGINO(mp, ip->i_ino), XFS_ICI_EOFBLOCKS_TAG);
+	ip->i_flags &= ~(XFS_IEOFBLOCKS | XFS_IEOFRECENT);
+	spin_unlock(&ip->i_flags_lock);
+	read_unlock(&pag->pag_ici_lock);
+	xfs_put_perag(mp, pag);
+}
+
+/*
+ * Trim post-EOF blocks from an idle tagged inode.  Anything busy - still
+ * extending its preallocation, dirty, under I/O or with the iolock held -
+ * keeps its blocks and is looked at again on the next scan.
+ */
+STATIC void
+xfs_inode_free_eofblocks(
+	xfs_mount_t	*mp,
+	xfs_inode_t	*ip)
+{
+	struct inode	*inode = VFS_I(ip);
+
+	if (xfs_iflags_test_and_clear(ip, XFS_IEOFRECENT))
+		return;
+	if (VN_DIRTY(inode) || atomic_read(&ip->i_iocount))
+		return;
+	if (!xfs_ilock_nowait(ip, XFS_IOLOCK_EXCL))
+		return;
+
+	if (!(ip->i_d.di_flags & (XFS_DIFLAG_PREALLOC | XFS_DIFLAG_APPEND)) &&
+	    (ip->i_df.if_flags & XFS_IFEXTENTS)) {
+		if (xfs_free_eofblocks(mp, ip, XFS_FREE_EOF_NOLOCK)) {
+			xfs_iunlock(ip, XFS_IOLOCK_EXCL);
+			return;
+		}
+	}
+	xfs_inode_clear_eofblocks_tag(ip);
+	xfs_iunlock(ip, XFS_IOLOCK_EXCL);
+}
+
+STATIC void
+xfs_free_eofblocks_ag(
+	xfs_mount_t	*mp,
+	int		ag)
+{
+	xfs_perag_t	*pag = &mp->m_perag[ag];
+	xfs_inode_t	*ip = NULL;
+	int		nr_found;
+	uint32_t	first_index = 0;
+
+	do {
+		read_lock(&pag->pag_ici_lock);
+		nr_found = radix_tree_gang_lookup_tag(&pag->pag_ici_root,
+					(void**)&ip, first_index, 1,
+					XFS_ICI_EOFBLOCKS_TAG);
+		if (!nr_found) {
+			read_unlock(&pag->pag_ici_lock);
+			break;
+		}
+
+		/*
+		 * The next lookup starts past this inode.  If the agino
+		 * wrapped, it was the last one in the AG, so stop.
+		 */
+		first_index = XFS_INO_TO_AGINO(mp, ip->i_ino + 1);
+		if (first_index < XFS_INO_TO_AGINO(mp, ip->i_ino)) {
+			read_unlock(&pag->pag_ici_lock);
+			break;
+		}
+
+		if (XFS_FORCED_SHUTDOWN(mp)) {
+			read_unlock(&pag->pag_ici_lock);
+			return;
+		}
+
+		/* inodes in reclaim lose their blocks on the way out */
+		if (!igrab(VFS_I(ip))) {
+			read_unlock(&pag->pag_ici_lock);
+			continue;
+		}
+		read_unlock(&pag->pag_ici_lock);
+
+		if (!is_bad_inode(VFS_I(ip)) &&
+		    !xfs_iflags_test(ip, XFS_INEW))
+			xfs_inode_free_eofblocks(mp, ip);
+		IRELE(ip);
+	} while (nr_found);
+}
+
+void
+xfs_free_eofblocks_all(
+	xfs_mount_t	*mp)
+{
+	int		i;
+
+	for (i = 0; i < mp->m_sb.sb_agcount; i++) {
+		if (!mp->m_perag[i].pag_ici_init)
+			continue;
+		xfs_free_eofblocks_ag(mp, i);
+	}
+}
+
 
@@ -210,6 +210,72 @@ static ctl_table xfs_table[] = {
 		.extra1		= &xfs_params.fstrm_timer.min,
 		.extra2		= &xfs_params.fstrm_timer.max,
 	},
+	{
+		.ctl_name	= XFS_ADAPT_LOGCOUNT,
+		.procname	= "adaptive_logcount",
+		.data		= &xfs_params.adapt_logcnt.val,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &xfs_params.adapt_logcnt.min,
+		.extra2		= &xfs_params.adapt_logcnt.max
+	},
+	{
+		.ctl_name	= XFS_EOFBLOCKS_TIMER,
+		.procname	= "speculative_prealloc_lifetime",
+		.data		= &xfs_params.eofb_timer.val,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &xfs_params.eofb_timer.min,
+		.extra2		= &xfs_params.eofb_timer.max
+	},
+	{
+		.ctl_name	= XFS_LAZYTIME_TIMER,
+		.procname	= "lazytime_centisecs",
+		.data		= &xfs_params.lazytime_timer.val,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &xfs_params.lazytime_timer.min,
+		.extra2		= &xfs_params.lazytime_timer.max
+	},
+	{
+		.ctl_name	= XFS_DIR_HCACHE,
+		.procname	= "dir_lookup_cache_entries",
+		.data		= &xfs_params.dir_hcache.val,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &xfs_params.dir_hcache.min,
+		.extra2		= &xfs_params.dir_hcache.max
+	},
+	{
+		.ctl_name	= XFS_DIR_HCACHE_TOTAL,
+		.procname	= "dir_lookup_cache_total",
+		.data		= &xfs_params.dir_hcache_tot.val,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &xfs_params.dir_hcache_tot.min,
+		.extra2		= &xfs_params.dir_hcache_tot.max
+	},
+	{
+		.ctl_name	= XFS_ATTR_RCACHE,
+		.procname	= "attr_remote_cache_bytes",
+		.data		= &xfs_params.attr_rcache.val,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &xfs_params.attr_rcache.min,
+		.extra2		= &xfs_params.attr_rcache.max
+	},
 	/* please keep this the last entry */
 #ifdef CONFIG_PROC_FS
 	{
@@ -47,6 +47,12 @@ typedef struct xfs_param {
 	xfs_sysctl_val_t rotorstep;	/* inode32 AG rotoring control knob */
 	xfs_sysctl_val_t inherit_nodfrg;/* Inherit the "nodefrag" inode flag. */
 	xfs_sysctl_val_t fstrm_timer;	/* Filestream dir-AG assoc'n timeout. */
+	xfs_sysctl_val_t adapt_logcnt;	/* Size perm log res by observed use */
+	xfs_sysctl_val_t eofb_timer;	/* Idle time before post-EOF trim. */
+	xfs_sysctl_val_t lazytime_timer;/* Interval between lazytime flushes. */
+	xfs_sysctl_val_t dir_hcache;	/* Names cached per node directory. */
+	xfs_sysctl_val_t dir_hcache_tot;/* Names cached in all directories. */
+	xfs_sysctl_val_t attr_rcache;	/* Remote attr bytes cached per inode. */
 } xfs_param_t;
 
 /*
@@ -87,6 +93,12 @@ enum {
 	XFS_ROTORSTEP = 20,
 	XFS_INHERIT_NODFRG = 21,
 	XFS_FILESTREAM_TIMER = 22,
+	XFS_ADAPT_LOGCOUNT = 23,
+	XFS_EOFBLOCKS_TIMER = 24,
+	XFS_LAZYTIME_TIMER = 25,
+	XFS_DIR_HCACHE = 26,
+	XFS_ATTR_RCACHE = 27,
+	XFS_DIR_HCACHE_TOTAL = 28,
 };
 
 extern xfs_param_t	xfs_params;
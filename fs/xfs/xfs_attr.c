@@ -88,7 +88,7 @@ STATIC int xfs_attr_refillstate(xfs_da_state_t *state);
 STATIC int xfs_attr_rmtval_set(xfs_da_args_t *args);
 STATIC int xfs_attr_rmtval_remove(xfs_da_args_t *args);
 
-#define ATTR_RMTVALUE_MAPSIZE	1	/* # of map entries at once */
+#define ATTR_RMTVALUE_MAPSIZE	8	/* # of map entries at once */
 
 #if defined(XFS_ATTR_TRACE)
 ktrace_t *xfs_attr_trace_buf;
@@ -194,6 +194,102 @@ xfs_attr_get(
 	return(error);
 }
 
+/*
+ * Look up an attribute by inode number, for bulk callers that walk many
+ * inodes.  If the inode is not in core and its attributes are shortform,
+ * the value is copied straight out of the inode cluster buffer instead
+ * of setting up and tearing down an incore inode for it.
+ *
+ * The inode cache is checked with the cluster buffer locked.  An inode
+ * that is not cached then has nothing newer than the buffer contents:
+ * bringing it into the cache has to read that buffer first, and inodes
+ * are flushed before they are reclaimed from the cache.
+ */
+int
+xfs_attr_get_by_ino(
+	xfs_mount_t	*mp,
+	xfs_ino_t	ino,
+	const char	*name,
+	char		*value,
+	int		*valuelenp,
+	int		flags)
+{
+	xfs_da_args_t	args;
+	struct xfs_name	xname;
+	xfs_perag_t	*pag;
+	xfs_dinode_t	*dip;
+	xfs_buf_t	*bp;
+	xfs_inode_t	*ip;
+	int		offset;
+	int		cached = 1;
+	int		error;
+
+	if (XFS_FORCED_SHUTDOWN(mp))
+		return(EIO);
+
+	error = xfs_attr_name_to_xname(&xname, name);
+	if (error)
+		return error;
+
+	error = xfs_inotobp(mp, NULL, ino, &dip, &bp, &offset,
+			    XFS_IGET_BULKSTAT);
+	if (error)
+		return error;
+
+	if (XFS_INO_TO_AGNO(mp, ino) < mp->m_maxagi) {
+		pag = xfs_get_perag(mp, ino);
+		if (pag->pagi_inodeok) {
+			read_lock(&pag->pag_ici_lock);
+			cached = radix_tree_lookup(&pag->pag_ici_root,
+					XFS_INO_TO_AGINO(mp, ino)) != NULL;
+			read_unlock(&pag->pag_ici_lock);
+		}
+		xfs_put_perag(mp, pag);
+	}
+
+	if (cached || be16_to_cpu(dip->di_magic) != XFS_DINODE_MAGIC ||
+	    dip->di_mode == 0) {
+		xfs_buf_relse(bp);
+		goto iget;
+	}
+
+	if (XFS_DFORK_Q(dip) && dip->di_aformat != XFS_DINODE_FMT_LOCAL &&
+	    (dip->di_aformat != XFS_DINODE_FMT_EXTENTS ||
+	     dip->di_anextents != 0)) {
+		xfs_buf_relse(bp);
+		goto iget;
+	}
+
+	XFS_STATS_INC(xs_attr_get);
+	if (!XFS_DFORK_Q(dip) || dip->di_aformat != XFS_DINODE_FMT_LOCAL) {
+		xfs_buf_relse(bp);
+		return ENOATTR;
+	}
+
+	memset((char *)&args, 0, sizeof(args));
+	args.name = xname.name;
+	args.namelen = xname.len;
+	args.value = value;
+	args.valuelen = *valuelenp;
+	args.flags = flags;
+	args.whichfork = XFS_ATTR_FORK;
+	error = xfs_attr_shortform_getvalue_dinode(mp, dip, &args);
+	xfs_buf_relse(bp);
+
+	*valuelenp = args.valuelen;
+	if (error == EEXIST)
+		error = 0;
+	return error;
+
+ iget:
+	error = xfs_iget(mp, NULL, ino, XFS_IGET_BULKSTAT, 0, &ip, 0);
+	if (error)
+		return error;
+	error = xfs_attr_get(ip, name, value, valuelenp, flags);
+	IRELE(ip);
+	return error;
+}
+
 /*
  * Calculate how many blocks we need for the new attribute,
  */
@@ -310,6 +406,7 @@ xfs_attr_set_int(xfs_inode_t *dp, struct xfs_name *name,
 		return(error);
 	}
 	xfs_ilock(dp, XFS_ILOCK_EXCL);
+	xfs_attr_rcache_free(dp);
 
 	error = XFS_TRANS_RESERVE_QUOTA_NBLKS(mp, args.trans, dp, args.total, 0,
 				rsvd ? XFS_QMOPT_RES_REGBLKS | XFS_QMOPT_FORCE_RES :
@@ -534,6 +631,7 @@ xfs_attr_remove_int(xfs_inode_t *dp, struct xfs_name *name, int flags)
 	}
 
 	xfs_ilock(dp, XFS_ILOCK_EXCL);
+	xfs_attr_rcache_free(dp);
 	/*
 	 * No need to make quota reservations here. We expect to release some
 	 * blocks not allocate in the common case.
@@ -808,6 +906,7 @@ xfs_attr_inactive(xfs_inode_t *dp)
 		return(error);
 	}
 	xfs_ilock(dp, XFS_ILOCK_EXCL);
+	xfs_attr_rcache_free(dp);
 
 	/*
 	 * No need to make quota reservations here. We expect to release some
@@ -1972,9 +2071,146 @@ xfs_attr_node_list(xfs_attr_list_context_t *context)
  * External routines for manipulating out-of-line attribute values.
  *========================================================================*/
 
+/*
+ * In-memory cache of remote attribute values.
+ *
+ * Values too large to live in an attribute leaf block are read from their
+ * own blocks on every get.  Inodes whose large values are read over and
+ * over keep the most recently read ones in memory, up to
+ * xfs_attr_rcache_bytes per inode, and serve repeat gets from there.
+ *
+ * Entries are keyed by the first logical block and length of the value,
+ * which between them identify one remote value while the attribute fork
+ * is unchanged.  Gets hold the ilock shared, and everything that can
+ * change or free remote values (xfs_attr_set_int, xfs_attr_remove_int and
+ * xfs_attr_inactive) throws the whole cache away with the ilock held
+ * exclusive, so a cached value is never stale.  rc_lock only serialises
+ * concurrent gets.
+ */
+typedef struct xfs_attr_rent {
+	struct list_head	re_list;	/* LRU, most recent first */
+	xfs_dablk_t		re_blkno;	/* first block of the value */
+	int			re_len;		/* value length */
+	char			re_value[1];	/* the value */
+} xfs_attr_rent_t;
+
+typedef struct xfs_attr_rcache {
+	spinlock_t		rc_lock;	/* protects everything below */
+	struct list_head	rc_lru;		/* cached values */
+	int			rc_bytes;	/* bytes of values cached */
+} xfs_attr_rcache_t;
+
+STATIC xfs_attr_rcache_t *
+xfs_attr_rcache_get(
+	xfs_inode_t		*dp)
+{
+	xfs_attr_rcache_t	*rc;
+
+	if (dp->i_acache)
+		return dp->i_acache;
+
+	rc = kmem_alloc(sizeof(xfs_attr_rcache_t), KM_NOFS | KM_MAYFAIL);
+	if (!rc)
+		return NULL;
+	spin_lock_init(&rc->rc_lock);
+	INIT_LIST_HEAD(&rc->rc_lru);
+	rc->rc_bytes = 0;
+
+	spin_lock(&dp->i_flags_lock);
+	if (!dp->i_acache) {
+		dp->i_acache = rc;
+		rc = NULL;
+	}
+	spin_unlock(&dp->i_flags_lock);
+	if (rc)
+		kmem_free(rc);
+	return dp->i_acache;
+}
+
+STATIC int
+xfs_attr_rcache_lookup(
+	xfs_da_args_t		*args)
+{
+	xfs_attr_rcache_t	*rc = args->dp->i_acache;
+	xfs_attr_rent_t		*re;
+
+	if (!rc)
+		return 0;
+
+	spin_lock(&rc->rc_lock);
+	list_for_each_entry(re, &rc->rc_lru, re_list) {
+		if (re->re_blkno != args->rmtblkno ||
+		    re->re_len != args->valuelen)
+			continue;
+		list_move(&re->re_list, &rc->rc_lru);
+		memcpy(args->value, re->re_value, re->re_len);
+		spin_unlock(&rc->rc_lock);
+		return 1;
+	}
+	spin_unlock(&rc->rc_lock);
+	return 0;
+}
+
+STATIC void
+xfs_attr_rcache_add(
+	xfs_da_args_t		*args)
+{
+	xfs_attr_rcache_t	*rc;
+	xfs_attr_rent_t		*re;
+	int			limit = xfs_attr_rcache_bytes;
+
+	if (args->valuelen > limit)
+		return;
+	rc = xfs_attr_rcache_get(args->dp);
+	if (!rc)
+		return;
+	re = kmem_alloc(offsetof(xfs_attr_rent_t, re_value) + args->valuelen,
+			KM_LARGE | KM_NOFS | KM_MAYFAIL);
+	if (!re)
+		return;
+	re->re_blkno = args->rmtblkno;
+	re->re_len = args->valuelen;
+	memcpy(re->re_value, args->value, args->valuelen);
+
+	spin_lock(&rc->rc_lock);
+	while (!list_empty(&rc->rc_lru) && rc->rc_bytes + re->re_len > limit) {
+		xfs_attr_rent_t	*victim;
+
+		victim = list_entry(rc->rc_lru.prev, xfs_attr_rent_t, re_list);
+		list_del(&victim->re_list);
+		rc->rc_bytes -= victim->re_len;
+		kmem_free(victim);
+	}
+	list_add(&re->re_list, &rc->rc_lru);
+	rc->rc_bytes += re->re_len;
+	spin_unlock(&rc->rc_lock);
+}
+
+/*
+ * Drop an inode's remote value cache, when its attributes change or
+ * the inode is torn down.
+ */
+void
+xfs_attr_rcache_free(
+	xfs_inode_t		*dp)
+{
+	xfs_attr_rcache_t	*rc = dp->i_acache;
+	xfs_attr_rent_t		*re, *next;
+
+	if (!rc)
+		return;
+	list_for_each_entry_safe(re, next, &rc->rc_lru, re_list)
+		kmem_free(re);
+	kmem_free(rc);
+	dp->i_acache = NULL;
+}
+
 /*
  * Read the value associated with an attribute from the out-of-line buffer
  * that we stored it in.
+ *
+ * Up to ATTR_RMTVALUE_MAPSIZE extents are mapped at a time, and reads of
+ * all of them are started before we wait for the first one.
  */
 int
 xfs_attr_rmtval_get(xfs_da_args_t *args)
@@ -1989,6 +2225,11 @@ xfs_attr_rmtval_get(xfs_da_args_t *args)
 
 	ASSERT(!(args->flags & ATTR_KERNOVAL));
 
+	if (xfs_attr_rcache_lookup(args)) {
+		XFS_STATS_INC(xs_attr_rcache_hit);
+		return(0);
+	}
+
 	mp = args->dp->i_mount;
 	dst = args->value;
 	valuelen = args->valuelen;
@@ -1996,13 +2237,21 @@ xfs_attr_rmtval_get(xfs_da_args_t *args)
 	while (valuelen > 0) {
 		nmap = ATTR_RMTVALUE_MAPSIZE;
 		error = xfs_bmapi(args->trans, args->dp, (xfs_fileoff_t)lblkno,
-				  args->rmtblkcnt,
+				  args->rmtblkcnt - (lblkno - args->rmtblkno),
 				  XFS_BMAPI_ATTRFORK | XFS_BMAPI_METADATA,
 				  NULL, 0, map, &nmap, NULL, NULL);
 		if (error)
 			return(error);
 		ASSERT(nmap >= 1);
 
+		for (i = 1; i < nmap; i++) {
+			ASSERT((map[i].br_startblock != DELAYSTARTBLOCK) &&
+			       (map[i].br_startblock != HOLESTARTBLOCK));
+			xfs_baread(mp->m_ddev_targp,
+				   XFS_FSB_TO_DADDR(mp, map[i].br_startblock),
+				   XFS_FSB_TO_BB(mp, map[i].br_blockcount));
+		}
+
 		for (i = 0; (i < nmap) && (valuelen > 0); i++) {
 			ASSERT((map[i].br_startblock != DELAYSTARTBLOCK) &&
 			       (map[i].br_startblock != HOLESTARTBLOCK));
@@ -2024,6 +2273,11 @@ xfs_attr_rmtval_get(xfs_da_args_t *args)
 		}
 	}
 	ASSERT(valuelen == 0);
+
+	if (xfs_attr_rcache_bytes) {
+		XFS_STATS_INC(xs_attr_rcache_miss);
+		xfs_attr_rcache_add(args);
+	}
 	return(0);
 }
 
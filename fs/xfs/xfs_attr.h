@@ -19,6 +19,7 @@
 #define	__XFS_ATTR_H__
 
 struct xfs_inode;
+struct xfs_mount;
 struct xfs_da_args;
 struct xfs_attr_list_context;
 
@@ -132,7 +133,10 @@ typedef struct xfs_attr_list_context {
 int xfs_attr_calc_size(struct xfs_inode *, int, int, int *);
 int xfs_attr_inactive(struct xfs_inode *dp);
 int xfs_attr_fetch(struct xfs_inode *, struct xfs_name *, char *, int *, int);
+int xfs_attr_get_by_ino(struct xfs_mount *, xfs_ino_t, const char *, char *,
+			int *, int);
 int xfs_attr_rmtval_get(struct xfs_da_args *args);
+void xfs_attr_rcache_free(struct xfs_inode *);
 int xfs_attr_list_int(struct xfs_attr_list_context *);
 
 #endif	/* __XFS_ATTR_H__ */
@@ -89,6 +89,8 @@ STATIC void xfs_attr_leaf_moveents(xfs_attr_leafblock_t *src_leaf,
 					 int dst_start, int move_count,
 					 xfs_mount_t *mp);
 STATIC int xfs_attr_leaf_entsize(xfs_attr_leafblock_t *leaf, int index);
+STATIC int xfs_attr_leaf_hash_index(xfs_attr_leaf_entry_t *entries,
+					 int count, xfs_dahash_t hash);
 
 /*========================================================================
  * Namespace helper routines
@@ -448,6 +450,71 @@ xfs_attr_shortform_getvalue(xfs_da_args_t *args)
 	return(XFS_ERROR(ENOATTR));
 }
 
+/*
+ * Look up a name in the shortform attribute fork of an on-disk inode,
+ * for callers that have the inode cluster buffer but no incore inode.
+ * Nothing has verified the fork yet, so every entry is bounds checked
+ * against the fork size before it is looked at.
+ */
+int
+xfs_attr_shortform_getvalue_dinode(
+	xfs_mount_t		*mp,
+	xfs_dinode_t		*dip,
+	xfs_da_args_t		*args)
+{
+	xfs_attr_shortform_t	*sf;
+	xfs_attr_sf_entry_t	*sfe;
+	char			*end;
+	int			size;
+	int			i;
+
+	ASSERT(dip->di_aformat == XFS_DINODE_FMT_LOCAL);
+	if (unlikely(XFS_DFORK_ASIZE(dip, mp) < (int)sizeof(sf->hdr))) {
+		XFS_CORRUPTION_ERROR("xfs_attr_shortform_getvalue_dinode",
+				     XFS_ERRLEVEL_LOW, mp, dip);
+		return XFS_ERROR(EFSCORRUPTED);
+	}
+	sf = (xfs_attr_shortform_t *)XFS_DFORK_APTR(dip);
+	size = be16_to_cpu(sf->hdr.totsize);
+	if (unlikely(size < (int)sizeof(sf->hdr) ||
+		     size > XFS_DFORK_ASIZE(dip, mp))) {
+		XFS_CORRUPTION_ERROR("xfs_attr_shortform_getvalue_dinode",
+				     XFS_ERRLEVEL_LOW, mp, sf);
+		return XFS_ERROR(EFSCORRUPTED);
+	}
+	end = (char *)sf + size;
+	sfe = &sf->list[0];
+	for (i = 0; i < sf->hdr.count;
+				sfe = XFS_ATTR_SF_NEXTENTRY(sfe), i++) {
+		if (unlikely((char *)sfe->nameval > end ||
+			     (char *)XFS_ATTR_SF_NEXTENTRY(sfe) > end)) {
+			XFS_CORRUPTION_ERROR(
+				"xfs_attr_shortform_getvalue_dinode",
+				XFS_ERRLEVEL_LOW, mp, sf);
+			return XFS_ERROR(EFSCORRUPTED);
+		}
+		if (sfe->namelen != args->namelen)
+			continue;
+		if (memcmp(args->name, sfe->nameval, args->namelen) != 0)
+			continue;
+		if (!xfs_attr_namesp_match(args->flags, sfe->flags))
+			continue;
+		if (args->flags & ATTR_KERNOVAL) {
+			args->valuelen = sfe->valuelen;
+			return XFS_ERROR(EEXIST);
+		}
+		if (args->valuelen < sfe->valuelen) {
+			args->valuelen = sfe->valuelen;
+			return XFS_ERROR(ERANGE);
+		}
+		args->valuelen = sfe->valuelen;
+		memcpy(args->value, &sfe->nameval[args->namelen],
+						    args->valuelen);
+		return XFS_ERROR(EEXIST);
+	}
+	return XFS_ERROR(ENOATTR);
+}
+
 /*
  * Convert from using the shortform to the leaf.
  */
@@ -527,6 +594,7 @@ xfs_attr_shortform_to_leaf(xfs_da_args_t *args)
 		sfe = XFS_ATTR_SF_NEXTENTRY(sfe);
 	}
 	error = 0;
+	XFS_STATS_INC(xs_attr_sf_to_leaf);
 
 out:
 	if(bp)
@@ -1046,6 +1114,18 @@ xfs_attr_leaf_add(xfs_dabuf_t *bp, xfs_da_args_t *args)
 	if (!hdr->holes && (sum < entsize))
 		return(XFS_ERROR(ENOSPC));
 
+	/*
+	 * Compaction rewrites and logs the whole block.  Only do it when
+	 * the holes are all that keeps the new entry out, i.e. when the
+	 * block has room for it once its names are packed together;
+	 * otherwise the caller is going to split the block anyway.
+	 */
+	tmp = XFS_LBSIZE(args->trans->t_mountp) - sizeof(xfs_attr_leaf_hdr_t)
+		- be16_to_cpu(hdr->count) * sizeof(xfs_attr_leaf_entry_t)
+		- be16_to_cpu(hdr->usedbytes);
+	if (tmp < entsize + (int)sizeof(xfs_attr_leaf_entry_t))
+		return(XFS_ERROR(ENOSPC));
+
 	/*
 	 * Compact the entries to coalesce free space.
 	 * This may change the hdr->count via dropping INCOMPLETE entries.
@@ -1920,8 +2000,8 @@ xfs_attr_leaf_lookup_int(xfs_dabuf_t *bp, xfs_da_args_t *args)
 	xfs_attr_leaf_entry_t *entry;
 	xfs_attr_leaf_name_local_t *name_loc;
 	xfs_attr_leaf_name_remote_t *name_rmt;
-	int probe, span;
-	xfs_dahash_t hashval;
+	int probe, count;
+	__be32 hashval;
 
 	leaf = bp->data;
 	ASSERT(be16_to_cpu(leaf->hdr.info.magic) == XFS_ATTR_LEAF_MAGIC);
@@ -1929,40 +2009,13 @@ xfs_attr_leaf_lookup_int(xfs_dabuf_t *bp, xfs_da_args_t *args)
 					< (XFS_LBSIZE(args->dp->i_mount)/8));
 
 	/*
-	 * Binary search.  (note: small blocks will skip this loop)
-	 */
-	hashval = args->hashval;
-	probe = span = be16_to_cpu(leaf->hdr.count) / 2;
-	for (entry = &leaf->entries[probe]; span > 4;
-		   entry = &leaf->entries[probe]) {
-		span /= 2;
-		if (be32_to_cpu(entry->hashval) < hashval)
-			probe += span;
-		else if (be32_to_cpu(entry->hashval) > hashval)
-			probe -= span;
-		else
-			break;
-	}
-	ASSERT((probe >= 0) &&
-	       (!leaf->hdr.count
-	       || (probe < be16_to_cpu(leaf->hdr.count))));
-	ASSERT((span <= 4) || (be32_to_cpu(entry->hashval) == hashval));
-
-	/*
-	 * Since we may have duplicate hashval's, find the first matching
-	 * hashval in the leaf.
+	 * Find the first entry with our hashval, if there is one.
 	 */
-	while ((probe > 0) && (be32_to_cpu(entry->hashval) >= hashval)) {
-		entry--;
-		probe--;
-	}
-	while ((probe < be16_to_cpu(leaf->hdr.count)) &&
-	       (be32_to_cpu(entry->hashval) < hashval)) {
-		entry++;
-		probe++;
-	}
-	if ((probe == be16_to_cpu(leaf->hdr.count)) ||
-	    (be32_to_cpu(entry->hashval) != hashval)) {
+	count = be16_to_cpu(leaf->hdr.count);
+	probe = xfs_attr_leaf_hash_index(leaf->entries, count, args->hashval);
+	entry = &leaf->entries[probe];
+	hashval = cpu_to_be32(args->hashval);
+	if (probe == count || entry->hashval != hashval) {
 		args->index = probe;
 		return(XFS_ERROR(ENOATTR));
 	}
@@ -1970,8 +2023,7 @@ xfs_attr_leaf_lookup_int(xfs_dabuf_t *bp, xfs_da_args_t *args)
 	/*
 	 * Duplicate keys may be present, so search all of them for a match.
 	 */
-	for (  ; (probe < be16_to_cpu(leaf->hdr.count)) &&
-			(be32_to_cpu(entry->hashval) == hashval);
+	for (  ; probe < count && entry->hashval == hashval;
 			entry++, probe++) {
 /*
  * GROT: Add code to remove incomplete entries.
@@ -2014,6 +2066,34 @@ xfs_attr_leaf_lookup_int(xfs_dabuf_t *bp, xfs_da_args_t *args)
 	return(XFS_ERROR(ENOATTR));
 }
 
+/*
+ * Return the index of the first of count sorted leaf entries whose hash
+ * value is not lower than hash, or count if there is none.  This is the
+ * same search as xfs_dir2_leaf_hash_index(): halve down to a few entries,
+ * then scan them in order.
+ */
+STATIC int
+xfs_attr_leaf_hash_index(
+	xfs_attr_leaf_entry_t	*entries,
+	int			count,
+	xfs_dahash_t		hash)
+{
+	int			high;
+	int			low;
+	int			mid;
+
+	for (low = 0, high = count; high - low > XFS_ATTR_LEAF_SCAN; ) {
+		mid = (low + high) >> 1;
+		if (be32_to_cpu(entries[mid].hashval) < hash)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	while (low < high && be32_to_cpu(entries[low].hashval) < hash)
+		low++;
+	return low;
+}
+
 /*
  * Get the value associated with an attribute name from a leaf attribute
  * list structure.
@@ -2333,8 +2413,10 @@ xfs_attr_leaf_list_int(xfs_dabuf_t *bp, xfs_attr_list_context_t *context)
 	 * Re-find our place in the leaf block if this is a new syscall.
 	 */
 	if (context->resynch) {
-		entry = &leaf->entries[0];
-		for (i = 0; i < be16_to_cpu(leaf->hdr.count); entry++, i++) {
+		i = xfs_attr_leaf_hash_index(leaf->entries,
+				be16_to_cpu(leaf->hdr.count), cursor->hashval);
+		entry = &leaf->entries[i];
+		for (  ; i < be16_to_cpu(leaf->hdr.count); entry++, i++) {
 			if (be32_to_cpu(entry->hashval) == cursor->hashval) {
 				if (cursor->offset == context->dupcnt) {
 					context->dupcnt = 0;
@@ -35,7 +35,9 @@ struct xfs_dabuf;
 struct xfs_da_args;
 struct xfs_da_state;
 struct xfs_da_state_blk;
+struct xfs_dinode;
 struct xfs_inode;
+struct xfs_mount;
 struct xfs_trans;
 
 /*========================================================================
@@ -71,6 +73,7 @@ struct xfs_trans;
  * need some indication that we weren't finished if we crash in the middle.
  */
 #define XFS_ATTR_LEAF_MAPSIZE	3	/* how many freespace slots */
+#define XFS_ATTR_LEAF_SCAN	8	/* hash search goes linear here */
 
 typedef struct xfs_attr_leaf_map {	/* RLE map of free bytes */
 	__be16	base;			  /* base of free region */
@@ -224,6 +227,9 @@ void	xfs_attr_shortform_create(struct xfs_da_args *args);
 void	xfs_attr_shortform_add(struct xfs_da_args *args, int forkoff);
 int	xfs_attr_shortform_lookup(struct xfs_da_args *args);
 int	xfs_attr_shortform_getvalue(struct xfs_da_args *args);
+int	xfs_attr_shortform_getvalue_dinode(struct xfs_mount *mp,
+					   struct xfs_dinode *dip,
+					   struct xfs_da_args *args);
 int	xfs_attr_shortform_to_leaf(struct xfs_da_args *args);
 int	xfs_attr_shortform_remove(struct xfs_da_args *args);
 int	xfs_attr_shortform_list(struct xfs_attr_list_context *context);
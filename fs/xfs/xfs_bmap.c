@@ -3600,6 +3600,60 @@ xfs_bmap_forkoff_reset(
 	}
 }
 
+/*
+ * Make room for dsize bytes of local data in the data fork by moving the
+ * attribute fork up into whatever it isn't using.
+ *
+ * Shortform directories are converted to block form as soon as they
+ * outgrow the data fork, but the attribute fork frequently has room to
+ * spare: an inode that got its attribute fork at the default offset, or
+ * whose attributes have since moved out to a leaf block, only needs the
+ * space for its local attributes or extent records.  On attr2 filesystems
+ * the fork offset may be moved as long as the attribute fork keeps room
+ * for its current contents and for a minimal btree root, which is the same
+ * limit xfs_attr_shortform_bytesfit() applies.
+ *
+ * Returns nonzero if the data fork is, or can be made, large enough.
+ * With a NULL tp only the check is done; otherwise the fork offset is
+ * moved and the inode core and attribute fork are logged.
+ */
+int
+xfs_bmap_forkoff_grow(
+	xfs_trans_t	*tp,		/* transaction pointer, or NULL */
+	xfs_inode_t	*ip,		/* incore inode pointer */
+	int		dsize)		/* bytes needed in the data fork */
+{
+	xfs_mount_t	*mp = ip->i_mount;
+	int		forkoff;	/* new fork offset, in 8 byte units */
+	int		maxforkoff;	/* highest allowed fork offset */
+
+	if (dsize <= XFS_IFORK_DSIZE(ip))
+		return 1;
+	if (!XFS_IFORK_Q(ip) || !(mp->m_flags & XFS_MOUNT_ATTR2) ||
+	    !xfs_sb_version_hasattr2(&mp->m_sb))
+		return 0;
+	if (ip->i_d.di_aformat != XFS_DINODE_FMT_LOCAL &&
+	    ip->i_d.di_aformat != XFS_DINODE_FMT_EXTENTS)
+		return 0;
+
+	maxforkoff = (XFS_LITINO(mp) - XFS_BMDR_SPACE_CALC(MINABTPTRS)) >> 3;
+	forkoff = MIN((XFS_LITINO(mp) - ip->i_afp->if_bytes) >> 3, maxforkoff);
+	if ((forkoff << 3) < dsize)
+		return 0;
+	if (!tp)
+		return 1;
+
+	ip->i_d.di_forkoff = forkoff;
+	ip->i_df.if_ext_max = XFS_IFORK_DSIZE(ip) / (uint)sizeof(xfs_bmbt_rec_t);
+	ip->i_afp->if_ext_max =
+		XFS_IFORK_ASIZE(ip) / (uint)sizeof(xfs_bmbt_rec_t);
+	xfs_trans_log_inode(tp, ip, XFS_ILOG_CORE |
+			(ip->i_d.di_aformat == XFS_DINODE_FMT_LOCAL ?
+			 XFS_ILOG_ADATA : XFS_ILOG_AEXT));
+	XFS_STATS_INC(xs_forkoff_grow);
+	return 1;
+}
+
 /*
  * Convert a local file to an extents file.
  * This code is out of bounds for data forks of regular files,
@@ -4870,6 +4924,13 @@ xfs_bmapi(
 	if ((flags & XFS_BMAPI_IGSTATE) && wr)	/* if writing unwritten space */
 		wr = 0;				/* no allocations are allowed */
 	ASSERT(wr || !(flags & XFS_BMAPI_DELAY));
+	/*
+	 * Drop any cached read mapping we may be about to change.  Delayed
+	 * allocation conversion can extend beyond the requested range, so
+	 * everything from bno onwards is suspect.
+	 */
+	if (wr && whichfork == XFS_DATA_FORK)
+		xfs_irmap_inval(ip, bno, NULLFILEOFF);
 	logflags = 0;
 	nallocs = 0;
 	cur = NULL;
@@ -5490,6 +5551,8 @@ xfs_bunmapi(
 	}
 	XFS_STATS_INC(xs_blk_unmap);
 	isrt = (whichfork == XFS_DATA_FORK) && XFS_IS_REALTIME_INODE(ip);
+	if (whichfork == XFS_DATA_FORK)
+		xfs_irmap_inval(ip, bno, bno + len);
 	start = bno;
 	bno = start + len - 1;
 	ep = xfs_bmap_search_extents(ip, bno, whichfork, &eof, &lastx, &got,
@@ -178,6 +178,15 @@ xfs_bmap_add_attrfork(
 	int			size,	/* space needed for new attribute */
 	int			rsvd);	/* flag for reserved block allocation */
 
+/*
+ * Move the attribute fork up to make room for local data fork contents.
+ */
+int
+xfs_bmap_forkoff_grow(
+	struct xfs_trans	*tp,	/* transaction pointer, or NULL */
+	struct xfs_inode	*ip,	/* incore inode pointer */
+	int			dsize);	/* bytes needed in the data fork */
+
 /*
  * Add the extent to the list of extents to be free at transaction end.
  * The list is maintained sorted (by block number).
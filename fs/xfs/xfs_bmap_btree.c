@@ -875,7 +875,7 @@ xfs_bmbt_init_cursor(
 	struct xfs_ifork	*ifp = XFS_IFORK_PTR(ip, whichfork);
 	struct xfs_btree_cur	*cur;
 
-	cur = kmem_zone_zalloc(xfs_btree_cur_zone, KM_SLEEP);
+	cur = xfs_btree_alloc_cursor(tp);
 
 	cur->bc_tp = tp;
 	cur->bc_mp = mp;
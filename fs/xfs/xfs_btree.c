@@ -208,6 +208,7 @@ xfs_btree_del_cursor(
 	int		error)		/* del because of error */
 {
 	int		i;		/* btree level */
+	xfs_trans_t	*tp;		/* transaction owning the cursor */
 
 	/*
 	 * Clear the buffer pointers, and release the buffers.
@@ -232,11 +233,53 @@ xfs_btree_del_cursor(
 	ASSERT(cur->bc_btnum != XFS_BTNUM_BMAP ||
 	       cur->bc_private.b.allocated == 0);
 	/*
-	 * Free the cursor.
+	 * Hand the cursor back to the transaction for reuse if there is
+	 * room in its cache, otherwise free it.
 	 */
+	tp = cur->bc_tp;
+	if (tp && tp->t_curcache_cnt < XFS_TRANS_CUR_CACHE) {
+		tp->t_curcache[tp->t_curcache_cnt++] = cur;
+		return;
+	}
 	kmem_zone_free(xfs_btree_cur_zone, cur);
 }
 
+/*
+ * Allocate a zeroed btree cursor.
+ *
+ * Transactions that walk the freespace and inode btrees create and
+ * destroy several cursors per operation, so reuse one that an earlier
+ * xfs_btree_del_cursor() call parked in the transaction if we can.  No
+ * buffers are held by a cached cursor; buffers already joined to the
+ * transaction are found again through the transaction item list.
+ */
+struct xfs_btree_cur *
+xfs_btree_alloc_cursor(
+	struct xfs_trans	*tp)	/* transaction pointer, can be NULL */
+{
+	struct xfs_btree_cur	*cur;
+
+	if (tp && tp->t_curcache_cnt > 0) {
+		cur = tp->t_curcache[--tp->t_curcache_cnt];
+		memset(cur, 0, sizeof(*cur));
+		return cur;
+	}
+	return kmem_zone_zalloc(xfs_btree_cur_zone, KM_SLEEP);
+}
+
+/*
+ * Free all cursors cached in a transaction.  Called when the
+ * transaction structure itself is freed.
+ */
+void
+xfs_btree_free_cursor_cache(
+	struct xfs_trans	*tp)
+{
+	while (tp->t_curcache_cnt > 0)
+		kmem_zone_free(xfs_btree_cur_zone,
+			       tp->t_curcache[--tp->t_curcache_cnt]);
+}
+
 /*
  * Duplicate the btree cursor.
  * Allocate a new one, copy the record, re-get the buffers.
@@ -803,6 +846,86 @@ xfs_btree_readahead(
 	return xfs_btree_readahead_sblock(cur, lr, block);
 }
 
+/*
+ * Read-ahead the child block pointed to by ptr.
+ */
+STATIC void
+xfs_btree_reada_ptr(
+	struct xfs_btree_cur	*cur,
+	union xfs_btree_ptr	*ptr)
+{
+	if (cur->bc_flags & XFS_BTREE_LONG_PTRS)
+		xfs_btree_reada_bufl(cur->bc_mp, be64_to_cpu(ptr->l), 1);
+	else
+		xfs_btree_reada_bufs(cur->bc_mp, cur->bc_private.a.agno,
+				     be32_to_cpu(ptr->s), 1);
+}
+
+/*
+ * Sequential readahead.
+ *
+ * Sibling readahead only ever gets one block ahead of the cursor, so a
+ * walk across many blocks of a level (a full tree scan, bulkstat, a big
+ * extent list) still waits for nearly every block it reads.  When the
+ * cursor steps onto a sibling block at level lev we treat the walk as
+ * sequential and grow a readahead window for that level, doubling it
+ * up to XFS_BTREE_RA_MAX blocks, much like page cache readahead does.
+ * The blocks in the window are found through the parent block's
+ * pointers rather than the sibling chain, so they can all be issued at
+ * once.  bc_ra_next of the parent level remembers how far through the
+ * parent we have issued so that each block is only issued once, and a
+ * change of direction starts the window over.
+ */
+STATIC void
+xfs_btree_readahead_seq(
+	struct xfs_btree_cur	*cur,		/* btree cursor */
+	int			lev,		/* level we stepped at */
+	int			lr)		/* direction of the step */
+{
+	struct xfs_btree_block	*block;
+	struct xfs_buf		*bp;
+	int			plev = lev + 1;
+	int			ptr;
+	int			first;
+	int			last;
+	int			i;
+
+	if (plev >= cur->bc_nlevels)
+		return;
+
+	if (cur->bc_ra_dir[lev] != lr) {
+		cur->bc_ra_dir[lev] = lr;
+		cur->bc_ra_win[lev] = 1;
+		cur->bc_ra_next[plev] = 0;
+	}
+	if (cur->bc_ra_win[lev] < XFS_BTREE_RA_MAX)
+		cur->bc_ra_win[lev] <<= 1;
+
+	block = xfs_btree_get_block(cur, plev, &bp);
+	ptr = cur->bc_ptrs[plev];
+
+	if (lr == XFS_BTCUR_RIGHTRA) {
+		first = max(ptr + 1, cur->bc_ra_next[plev]);
+		last = min_t(int, ptr + cur->bc_ra_win[lev],
+			     xfs_btree_get_numrecs(block));
+		for (i = first; i <= last; i++)
+			xfs_btree_reada_ptr(cur,
+					xfs_btree_ptr_addr(cur, i, block));
+		if (last >= first)
+			cur->bc_ra_next[plev] = last + 1;
+	} else {
+		first = ptr - 1;
+		if (cur->bc_ra_next[plev] && cur->bc_ra_next[plev] <= first)
+			first = cur->bc_ra_next[plev] - 1;
+		last = max(ptr - cur->bc_ra_win[lev], 1);
+		for (i = first; i >= last; i--)
+			xfs_btree_reada_ptr(cur,
+					xfs_btree_ptr_addr(cur, i, block));
+		if (first >= last)
+			cur->bc_ra_next[plev] = last;
+	}
+}
+
 /*
  * Set the buffer for level "lev" in the cursor to bp, releasing
  * any previous buffer.
@@ -821,6 +944,7 @@ xfs_btree_setbuf(
 		xfs_trans_brelse(cur->bc_tp, obp);
 	cur->bc_bufs[lev] = bp;
 	cur->bc_ra[lev] = 0;
+	cur->bc_ra_next[lev] = 0;
 	if (!bp)
 		return;
 	b = XFS_BUF_TO_BLOCK(bp);
@@ -1363,11 +1487,14 @@ xfs_btree_increment(
 
 	/*
 	 * Now walk back down the tree, fixing up the cursor's buffer
-	 * pointers and key numbers.
+	 * pointers and key numbers.  Every level we pass on the way
+	 * down has just moved on to its right sibling, so kick off
+	 * sequential readahead for it before we wait for the read.
 	 */
 	for (block = xfs_btree_get_block(cur, lev, &bp); lev > level; ) {
 		union xfs_btree_ptr	*ptrp;
 
+		xfs_btree_readahead_seq(cur, lev - 1, XFS_BTCUR_RIGHTRA);
 		ptrp = xfs_btree_ptr_addr(cur, cur->bc_ptrs[lev], block);
 		error = xfs_btree_read_buf_block(cur, ptrp, --lev,
 							0, &block, &bp);
@@ -1462,11 +1589,13 @@ xfs_btree_decrement(
 
 	/*
 	 * Now walk back down the tree, fixing up the cursor's buffer
-	 * pointers and key numbers.
+	 * pointers and key numbers, with sequential readahead to the
+	 * left for each level as in xfs_btree_increment.
 	 */
 	for (block = xfs_btree_get_block(cur, lev, &bp); lev > level; ) {
 		union xfs_btree_ptr	*ptrp;
 
+		xfs_btree_readahead_seq(cur, lev - 1, XFS_BTCUR_LEFTRA);
 		ptrp = xfs_btree_ptr_addr(cur, cur->bc_ptrs[lev], block);
 		error = xfs_btree_read_buf_block(cur, ptrp, --lev,
 							0, &block, &bp);
@@ -1572,6 +1701,9 @@ xfs_btree_lookup(
 
 	XFS_BTREE_STATS_INC(cur, lookup);
 
+	/* A lookup ends any sequential walk the cursor was doing. */
+	memset(cur->bc_ra_dir, 0, sizeof(cur->bc_ra_dir));
+
 	block = NULL;
 	keyno = 0;
 
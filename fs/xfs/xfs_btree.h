@@ -139,6 +139,7 @@ do {    \
 } while (0)
 
 #define	XFS_BTREE_MAXLEVELS	8	/* max of all btrees */
+#define	XFS_BTREE_RA_MAX	32	/* max sequential readahead window */
 
 struct xfs_btree_ops {
 	/* size of the key and record structures */
@@ -250,6 +251,10 @@ typedef struct xfs_btree_cur
 	__uint8_t	bc_ra[XFS_BTREE_MAXLEVELS];	/* readahead bits */
 #define	XFS_BTCUR_LEFTRA	1	/* left sibling has been read-ahead */
 #define	XFS_BTCUR_RIGHTRA	2	/* right sibling has been read-ahead */
+	__uint8_t	bc_ra_dir[XFS_BTREE_MAXLEVELS];	/* seq. walk direction */
+	__uint8_t	bc_ra_win[XFS_BTREE_MAXLEVELS];	/* seq. readahead window */
+	int		bc_ra_next[XFS_BTREE_MAXLEVELS]; /* seq. readahead
+							    issued to ptr # */
 	__uint8_t	bc_nlevels;	/* number of levels in the tree */
 	__uint8_t	bc_blocklog;	/* log2(blocksize) of btree blocks */
 	xfs_btnum_t	bc_btnum;	/* identifies which btree type */
@@ -313,6 +318,20 @@ xfs_btree_del_cursor(
 	xfs_btree_cur_t		*cur,	/* btree cursor */
 	int			error);	/* del because of error */
 
+/*
+ * Allocate a zeroed btree cursor, reusing one cached in the transaction.
+ */
+struct xfs_btree_cur *
+xfs_btree_alloc_cursor(
+	struct xfs_trans	*tp);	/* transaction pointer, can be NULL */
+
+/*
+ * Free the btree cursors cached in a transaction.
+ */
+void
+xfs_btree_free_cursor_cache(
+	struct xfs_trans	*tp);	/* transaction pointer */
+
 /*
  * Duplicate the btree cursor.
  * Allocate a new one, copy the record, re-get the buffers.
@@ -1501,18 +1501,43 @@ xfs_da_path_shift(xfs_da_state_t *state, xfs_da_state_path_t *path,
  * Implement a simple hash on a character string.
  * Rotate the hash value by 7 bits, then XOR each character in.
  * This is implemented with some source-level loop unrolling.
+ *
+ * The main loop folds in eight characters at a time.  Rotating is
+ * linear over XOR, so the two four character groups can be combined
+ * independently and the running hash only goes through one rotate per
+ * eight characters instead of two, which roughly halves the length of
+ * the dependency chain for long names.  The result is identical to
+ * doing one character at a time.
  */
 xfs_dahash_t
 xfs_da_hashname(const uchar_t *name, int namelen)
 {
 	xfs_dahash_t hash;
+	xfs_dahash_t lo, hi;
+
+	/*
+	 * Do eight characters at a time as long as we can.  Rotating the
+	 * hash by 7 bits per character over eight characters is a rotate
+	 * by 56, which is the same as a rotate by 24; spell it that way,
+	 * as rol32() shifting by more than 31 is undefined.
+	 */
+	for (hash = 0; namelen >= 8; namelen -= 8, name += 8) {
+		hi = (name[0] << 21) ^ (name[1] << 14) ^ (name[2] << 7) ^
+		     (name[3] << 0);
+		lo = (name[4] << 21) ^ (name[5] << 14) ^ (name[6] << 7) ^
+		     (name[7] << 0);
+		hash = rol32(hash, 7 * 8 - 32) ^ rol32(hi, 7 * 4) ^ lo;
+	}
 
 	/*
-	 * Do four characters at a time as long as we can.
+	 * Then four if there are enough left.
 	 */
-	for (hash = 0; namelen >= 4; namelen -= 4, name += 4)
+	if (namelen >= 4) {
 		hash = (name[0] << 21) ^ (name[1] << 14) ^ (name[2] << 7) ^
 		       (name[3] << 0) ^ rol32(hash, 7 * 4);
+		namelen -= 4;
+		name += 4;
+	}
 
 	/*
 	 * Now do the rest of the characters.
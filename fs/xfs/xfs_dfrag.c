@@ -287,6 +287,8 @@ xfs_swap_extents(
 	 */
 	ifp = &ip->i_df;
 	tifp = &tip->i_df;
+	xfs_irmap_inval(ip, 0, NULLFILEOFF);
+	xfs_irmap_inval(tip, 0, NULLFILEOFF);
 	*tempifp = *ifp;	/* struct copy */
 	*ifp = *tifp;		/* struct copy */
 	*tifp = *tempifp;	/* struct copy */
@@ -51,16 +51,32 @@ extern const struct xfs_nameops xfs_default_nameops;
 /*
  * ASCII case-insensitive (ie. A-Z) support for directories that was
  * used in IRIX.
+ *
+ * Names are folded through a table filled in from tolower() at startup,
+ * which keeps the hash identical to the one on disk while avoiding the
+ * character class tests of tolower() for every byte of every name.
  */
+static unsigned char xfs_ascii_ci_fold[256];
+
+void
+xfs_dir_ci_startup(void)
+{
+	int		i;
+
+	for (i = 0; i < 256; i++)
+		xfs_ascii_ci_fold[i] = tolower(i);
+}
+
 STATIC xfs_dahash_t
 xfs_ascii_ci_hashname(
 	struct xfs_name	*name)
 {
+	const unsigned char *cp = (const unsigned char *)name->name;
 	xfs_dahash_t	hash;
 	int		i;
 
 	for (i = 0, hash = 0; i < name->len; i++)
-		hash = tolower(name->name[i]) ^ rol32(hash, 7);
+		hash = xfs_ascii_ci_fold[cp[i]] ^ rol32(hash, 7);
 
 	return hash;
 }
@@ -71,22 +87,20 @@ xfs_ascii_ci_compname(
 	const char	*name,
 	int 		len)
 {
-	enum xfs_dacmp	result;
+	const unsigned char *a = args->name;
+	const unsigned char *b = (const unsigned char *)name;
 	int		i;
 
 	if (args->namelen != len)
 		return XFS_CMP_DIFFERENT;
+	if (!memcmp(a, b, len))
+		return XFS_CMP_EXACT;
 
-	result = XFS_CMP_EXACT;
 	for (i = 0; i < len; i++) {
-		if (args->name[i] == name[i])
-			continue;
-		if (tolower(args->name[i]) != tolower(name[i]))
+		if (xfs_ascii_ci_fold[a[i]] != xfs_ascii_ci_fold[b[i]])
 			return XFS_CMP_DIFFERENT;
-		result = XFS_CMP_CASE;
 	}
-
-	return result;
+	return XFS_CMP_CASE;
 }
 
 static struct xfs_nameops xfs_ascii_ci_nameops = {
@@ -267,6 +281,294 @@ xfs_dir_cilookup_result(
 	return EEXIST;
 }
 
+/*
+ * In-memory lookup cache for node format directories.
+ *
+ * A node directory lookup walks the da btree from the root down to a leaf
+ * block, searches the leaf hashes and then reads the data block to compare
+ * the name, all under the directory ilock.  For very large directories that
+ * are looked up much more often than they change we keep the names found by
+ * recent lookups in a small per-directory hash table keyed by the directory
+ * name hash, so that repeat lookups of hot names need none of that.
+ *
+ * The table is created by the first lookup that has to go to the node
+ * format code and holds at most xfs_dir_hcache_entries names, after which
+ * each new name pushes out the oldest name of some hash chain.  All the
+ * tables together hold at most xfs_dir_hcache_total names; past that a
+ * directory can only replace names of its own, and one with none cached
+ * adds nothing.  Only names
+ * that exist are cached, never negative results, so creating a name cannot
+ * make anything in the cache wrong.  Removing or replacing a name drops
+ * every cached name with the same hash value.
+ *
+ * Cached names are compared with the directory's compname method, so on
+ * ascii-ci filesystems the table also works as a folded name index: a
+ * lookup of "readme" is answered by a cached "README" and hands back the
+ * real name, without going back to the leaf and data blocks to search all
+ * the names with that hash.  Names there are unique ignoring case, so a
+ * cached entry is the only match.
+ *
+ * Lookups hold the ilock shared and modifications hold it exclusive, so
+ * the cache never disagrees with the directory as seen under the ilock;
+ * hc_lock only serialises lookups filling it in concurrently.
+ */
+typedef struct xfs_dir2_hent {
+	struct hlist_node	he_list;	/* hash chain */
+	xfs_ino_t		he_ino;		/* inode number of the name */
+	xfs_dahash_t		he_hash;	/* directory name hash */
+	unsigned char		he_namelen;	/* name length */
+	unsigned char		he_name[1];	/* name, not null terminated */
+} xfs_dir2_hent_t;
+
+typedef struct xfs_dir2_hcache {
+	spinlock_t		hc_lock;	/* protects everything below */
+	unsigned int		hc_count;	/* names cached */
+	unsigned int		hc_max;		/* names we may cache */
+	unsigned int		hc_mask;	/* number of chains - 1 */
+	unsigned int		hc_clock;	/* next chain to evict from */
+	struct hlist_head	hc_chains[1];	/* hash chains */
+} xfs_dir2_hcache_t;
+
+#define XFS_DIR2_HCACHE_MINCHAINS	16
+#define XFS_DIR2_HCACHE_MAXCHAINS	8192
+
+/* Names cached over all directories. */
+static atomic_t		xfs_dir2_hcache_names = ATOMIC_INIT(0);
+
+STATIC xfs_dir2_hcache_t *
+xfs_dir2_hcache_get(
+	xfs_inode_t		*dp)
+{
+	xfs_dir2_hcache_t	*hc;
+	unsigned int		maxents = xfs_dir_hcache_entries;
+	unsigned int		nchains;
+
+	if (dp->i_dcache || !maxents || !xfs_dir_hcache_total)
+		return dp->i_dcache;
+
+	nchains = roundup_pow_of_two(max_t(unsigned int, maxents / 8,
+					   XFS_DIR2_HCACHE_MINCHAINS));
+	nchains = min_t(unsigned int, nchains, XFS_DIR2_HCACHE_MAXCHAINS);
+	hc = kmem_zalloc(offsetof(xfs_dir2_hcache_t, hc_chains) +
+			 nchains * sizeof(struct hlist_head),
+			 KM_LARGE | KM_NOFS | KM_MAYFAIL);
+	if (!hc)
+		return NULL;
+	spin_lock_init(&hc->hc_lock);
+	hc->hc_max = maxents;
+	hc->hc_mask = nchains - 1;
+
+	spin_lock(&dp->i_flags_lock);
+	if (!dp->i_dcache) {
+		dp->i_dcache = hc;
+		hc = NULL;
+	}
+	spin_unlock(&dp->i_flags_lock);
+	if (hc)
+		kmem_free(hc);
+	return dp->i_dcache;
+}
+
+STATIC xfs_dir2_hent_t *
+xfs_dir2_hcache_find(
+	xfs_dir2_hcache_t	*hc,
+	struct xfs_name		*name,
+	xfs_dahash_t		hash)
+{
+	xfs_dir2_hent_t		*he;
+	struct hlist_node	*node;
+
+	hlist_for_each_entry(he, node, &hc->hc_chains[hash & hc->hc_mask],
+			     he_list) {
+		if (he->he_hash == hash && he->he_namelen == name->len &&
+		    !memcmp(he->he_name, name->name, name->len))
+			return he;
+	}
+	return NULL;
+}
+
+/*
+ * Look up args->name in the cache.  On a hit, fill in args like the
+ * directory format lookup routines do and return EEXIST.  Returns 0 on a
+ * miss, with args untouched.
+ */
+STATIC int
+xfs_dir2_hcache_lookup(
+	xfs_dir2_hcache_t	*hc,
+	xfs_da_args_t		*args)
+{
+	const struct xfs_nameops *nameops = args->dp->i_mount->m_dirnameops;
+	xfs_dir2_hent_t		*he;
+	struct hlist_node	*node;
+	enum xfs_dacmp		cmp = XFS_CMP_DIFFERENT;
+	xfs_ino_t		ino = 0;
+	char			name[MAXNAMELEN];
+	int			namelen = 0;
+
+	spin_lock(&hc->hc_lock);
+	hlist_for_each_entry(he, node,
+			&hc->hc_chains[args->hashval & hc->hc_mask], he_list) {
+		if (he->he_hash != args->hashval)
+			continue;
+		cmp = nameops->compname(args, (char *)he->he_name,
+					he->he_namelen);
+		if (cmp == XFS_CMP_DIFFERENT)
+			continue;
+		ino = he->he_ino;
+		if (cmp == XFS_CMP_CASE &&
+		    (args->op_flags & XFS_DA_OP_CILOOKUP)) {
+			namelen = he->he_namelen;
+			memcpy(name, he->he_name, namelen);
+		}
+		break;
+	}
+	spin_unlock(&hc->hc_lock);
+
+	if (cmp == XFS_CMP_DIFFERENT)
+		return 0;
+	if (namelen) {
+		args->value = kmem_alloc(namelen, KM_MAYFAIL);
+		if (!args->value)
+			return ENOMEM;
+		memcpy(args->value, name, namelen);
+		args->valuelen = namelen;
+	}
+	args->inumber = ino;
+	args->cmpresult = cmp;
+	return EEXIST;
+}
+
+/*
+ * Make room for one more name by dropping the oldest name of the first
+ * non-empty chain at or after the clock hand.  Names are added at the
+ * head of their chain, so the oldest one is at the tail.
+ */
+STATIC void
+xfs_dir2_hcache_evict(
+	xfs_dir2_hcache_t	*hc)
+{
+	struct hlist_head	*head;
+	xfs_dir2_hent_t		*he;
+	struct hlist_node	*node;
+	xfs_dir2_hent_t		*victim = NULL;
+
+	do {
+		head = &hc->hc_chains[hc->hc_clock++ & hc->hc_mask];
+		hlist_for_each_entry(he, node, head, he_list)
+			victim = he;
+	} while (!victim);
+
+	hlist_del(&victim->he_list);
+	hc->hc_count--;
+	atomic_dec(&xfs_dir2_hcache_names);
+	kmem_free(victim);
+}
+
+/*
+ * Cache the result of a successful lookup under the name it was found
+ * with on disk.  For a case-insensitive match that is only known if the
+ * caller asked for it.
+ */
+STATIC void
+xfs_dir2_hcache_add(
+	xfs_inode_t		*dp,
+	xfs_da_args_t		*args)
+{
+	xfs_dir2_hcache_t	*hc;
+	xfs_dir2_hent_t		*he;
+	struct xfs_name		name;
+	xfs_dahash_t		hash = args->hashval;
+
+	if (args->cmpresult == XFS_CMP_EXACT) {
+		name.name = (const char *)args->name;
+		name.len = args->namelen;
+	} else if (args->value) {
+		name.name = args->value;
+		name.len = args->valuelen;
+	} else
+		return;
+
+	hc = xfs_dir2_hcache_get(dp);
+	if (!hc)
+		return;
+	he = kmem_alloc(offsetof(xfs_dir2_hent_t, he_name) + name.len,
+			KM_NOFS | KM_MAYFAIL);
+	if (!he)
+		return;
+	he->he_ino = args->inumber;
+	he->he_hash = hash;
+	he->he_namelen = name.len;
+	memcpy(he->he_name, name.name, name.len);
+
+	spin_lock(&hc->hc_lock);
+	if (xfs_dir2_hcache_find(hc, &name, hash)) {
+		spin_unlock(&hc->hc_lock);
+		kmem_free(he);
+		return;
+	}
+	if (atomic_read(&xfs_dir2_hcache_names) >= xfs_dir_hcache_total) {
+		if (!hc->hc_count) {
+			spin_unlock(&hc->hc_lock);
+			kmem_free(he);
+			return;
+		}
+		xfs_dir2_hcache_evict(hc);
+	} else if (hc->hc_count >= hc->hc_max)
+		xfs_dir2_hcache_evict(hc);
+	hlist_add_head(&he->he_list, &hc->hc_chains[hash & hc->hc_mask]);
+	hc->hc_count++;
+	atomic_inc(&xfs_dir2_hcache_names);
+	spin_unlock(&hc->hc_lock);
+}
+
+/*
+ * Drop all cached names with the given hash value.
+ */
+STATIC void
+xfs_dir2_hcache_inval(
+	xfs_dir2_hcache_t	*hc,
+	xfs_dahash_t		hash)
+{
+	xfs_dir2_hent_t		*he;
+	struct hlist_node	*node, *next;
+
+	spin_lock(&hc->hc_lock);
+	hlist_for_each_entry_safe(he, node, next,
+			&hc->hc_chains[hash & hc->hc_mask], he_list) {
+		if (he->he_hash != hash)
+			continue;
+		hlist_del(&he->he_list);
+		hc->hc_count--;
+		atomic_dec(&xfs_dir2_hcache_names);
+		kmem_free(he);
+	}
+	spin_unlock(&hc->hc_lock);
+}
+
+/*
+ * Free a directory's lookup cache when the inode is torn down.
+ */
+void
+xfs_dir2_hcache_free(
+	xfs_inode_t		*dp)
+{
+	xfs_dir2_hcache_t	*hc = dp->i_dcache;
+	xfs_dir2_hent_t		*he;
+	struct hlist_node	*node, *next;
+	unsigned int		i;
+
+	if (!hc)
+		return;
+	for (i = 0; i <= hc->hc_mask; i++) {
+		hlist_for_each_entry_safe(he, node, next, &hc->hc_chains[i],
+					  he_list)
+			kmem_free(he);
+	}
+	atomic_sub(hc->hc_count, &xfs_dir2_hcache_names);
+	kmem_free(hc);
+	dp->i_dcache = NULL;
+}
+
 /*
  * Lookup a name in a directory, give back the inode number.
  * If ci_name is not NULL, returns the actual name in ci_name if it differs
@@ -299,6 +601,14 @@ xfs_dir_lookup(
 	if (ci_name)
 		args.op_flags |= XFS_DA_OP_CILOOKUP;
 
+	if (dp->i_dcache) {
+		rval = xfs_dir2_hcache_lookup(dp->i_dcache, &args);
+		if (rval == EEXIST)
+			XFS_STATS_INC(xs_dir_hcache_hit);
+		if (rval)
+			goto out;
+	}
+
 	if (dp->i_d.di_format == XFS_DINODE_FMT_LOCAL)
 		rval = xfs_dir2_sf_lookup(&args);
 	else if ((rval = xfs_dir2_isblock(tp, dp, &v)))
@@ -309,8 +619,15 @@ xfs_dir_lookup(
 		return rval;
 	else if (v)
 		rval = xfs_dir2_leaf_lookup(&args);
-	else
+	else {
 		rval = xfs_dir2_node_lookup(&args);
+		if (xfs_dir_hcache_entries) {
+			XFS_STATS_INC(xs_dir_hcache_miss);
+			if (rval == EEXIST)
+				xfs_dir2_hcache_add(dp, &args);
+		}
+	}
+ out:
 	if (rval == EEXIST)
 		rval = 0;
 	if (!rval) {
@@ -355,6 +672,9 @@ xfs_dir_removename(
 	args.whichfork = XFS_DATA_FORK;
 	args.trans = tp;
 
+	if (dp->i_dcache)
+		xfs_dir2_hcache_inval(dp->i_dcache, args.hashval);
+
 	if (dp->i_d.di_format == XFS_DINODE_FMT_LOCAL)
 		rval = xfs_dir2_sf_removename(&args);
 	else if ((rval = xfs_dir2_isblock(tp, dp, &v)))
@@ -438,6 +758,9 @@ xfs_dir_replace(
 	args.whichfork = XFS_DATA_FORK;
 	args.trans = tp;
 
+	if (dp->i_dcache)
+		xfs_dir2_hcache_inval(dp->i_dcache, args.hashval);
+
 	if (dp->i_d.di_format == XFS_DINODE_FMT_LOCAL)
 		rval = xfs_dir2_sf_replace(&args);
 	else if ((rval = xfs_dir2_isblock(tp, dp, &v)))
@@ -742,6 +1065,7 @@ xfs_dir2_shrink_inode(
 	 */
 	if (db >= XFS_DIR2_LEAF_FIRSTDB(mp))
 		return 0;
+	xfs_dir2_fsum_set(dp, db, NULLDATAOFF);
 	/*
 	 * If the block isn't the last one in the directory, we're done.
 	 */
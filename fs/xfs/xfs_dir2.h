@@ -65,6 +65,7 @@ extern struct xfs_name	xfs_name_dotdot;
  * Generic directory interface routines
  */
 extern void xfs_dir_startup(void);
+extern void xfs_dir_ci_startup(void);
 extern void xfs_dir_mount(struct xfs_mount *mp);
 extern int xfs_dir_isempty(struct xfs_inode *dp);
 extern int xfs_dir_init(struct xfs_trans *tp, struct xfs_inode *dp,
@@ -87,6 +88,8 @@ extern int xfs_dir_replace(struct xfs_trans *tp, struct xfs_inode *dp,
 extern int xfs_dir_canenter(struct xfs_trans *tp, struct xfs_inode *dp,
 				struct xfs_name *name, uint resblks);
 extern int xfs_dir_ino_validate(struct xfs_mount *mp, xfs_ino_t ino);
+extern void xfs_dir2_hcache_free(struct xfs_inode *dp);
+extern void xfs_dir2_fsum_free(struct xfs_inode *dp);
 
 /*
  * Utility routines for v2 directories.
@@ -33,6 +33,7 @@
 #include "xfs_dinode.h"
 #include "xfs_inode.h"
 #include "xfs_inode_item.h"
+#include "xfs_bmap.h"
 #include "xfs_dir2_data.h"
 #include "xfs_dir2_leaf.h"
 #include "xfs_dir2_block.h"
@@ -59,6 +60,7 @@ xfs_dir_startup(void)
 {
 	xfs_dir_hash_dot = xfs_da_hashname(".", 1);
 	xfs_dir_hash_dotdot = xfs_da_hashname("..", 2);
+	xfs_dir_ci_startup();
 }
 
 /*
@@ -638,10 +640,9 @@ xfs_dir2_block_lookup_int(
 	xfs_dir2_data_entry_t	*dep;		/* block data entry */
 	xfs_inode_t		*dp;		/* incore inode */
 	int			error;		/* error return value */
-	xfs_dahash_t		hash;		/* found hash value */
-	int			high;		/* binary search high index */
-	int			low;		/* binary search low index */
-	int			mid;		/* binary search current idx */
+	__be32			bhash;		/* hash value, disk order */
+	int			count;		/* count of leaf entries */
+	int			mid;		/* current leaf entry index */
 	xfs_mount_t		*mp;		/* filesystem mount point */
 	xfs_trans_t		*tp;		/* transaction pointer */
 	enum xfs_dacmp		cmp;		/* comparison result */
@@ -662,37 +663,26 @@ xfs_dir2_block_lookup_int(
 	btp = xfs_dir2_block_tail_p(mp, block);
 	blp = xfs_dir2_block_leaf_p(btp);
 	/*
-	 * Loop doing a binary search for our hash value.
-	 * Find our entry, ENOENT if it's not there.
+	 * Find the first entry with our hash value, ENOENT if there
+	 * is none.
 	 */
-	for (low = 0, high = be32_to_cpu(btp->count) - 1; ; ) {
-		ASSERT(low <= high);
-		mid = (low + high) >> 1;
-		if ((hash = be32_to_cpu(blp[mid].hashval)) == args->hashval)
-			break;
-		if (hash < args->hashval)
-			low = mid + 1;
-		else
-			high = mid - 1;
-		if (low > high) {
-			ASSERT(args->op_flags & XFS_DA_OP_OKNOENT);
-			xfs_da_brelse(tp, bp);
-			return XFS_ERROR(ENOENT);
-		}
-	}
-	/*
-	 * Back up to the first one with the right hash value.
-	 */
-	while (mid > 0 && be32_to_cpu(blp[mid - 1].hashval) == args->hashval) {
-		mid--;
+	count = be32_to_cpu(btp->count);
+	bhash = cpu_to_be32(args->hashval);
+	mid = xfs_dir2_leaf_hash_index(blp, count, args->hashval);
+	if (mid == count || blp[mid].hashval != bhash) {
+		ASSERT(args->op_flags & XFS_DA_OP_OKNOENT);
+		xfs_da_brelse(tp, bp);
+		return XFS_ERROR(ENOENT);
 	}
 	/*
 	 * Now loop forward through all the entries with the
-	 * right hash value looking for our name.
+	 * right hash value looking for our name.  The hash values are
+	 * compared in disk order, so there is no byte swapping per entry.
 	 */
 	do {
-		if ((addr = be32_to_cpu(blp[mid].address)) == XFS_DIR2_NULL_DATAPTR)
+		if (blp[mid].address == cpu_to_be32(XFS_DIR2_NULL_DATAPTR))
 			continue;
+		addr = be32_to_cpu(blp[mid].address);
 		/*
 		 * Get pointer to the entry from the leaf.
 		 */
@@ -711,8 +701,7 @@ xfs_dir2_block_lookup_int(
 			if (cmp == XFS_CMP_EXACT)
 				return 0;
 		}
-	} while (++mid < be32_to_cpu(btp->count) &&
-			be32_to_cpu(blp[mid].hashval) == hash);
+	} while (++mid < count && blp[mid].hashval == bhash);
 
 	ASSERT(args->op_flags & XFS_DA_OP_OKNOENT);
 	/*
@@ -798,8 +787,8 @@ xfs_dir2_block_removename(
 	/*
 	 * See if the size as a shortform is good enough.
 	 */
-	if ((size = xfs_dir2_block_sfsize(dp, block, &sfh)) >
-	    XFS_IFORK_DSIZE(dp)) {
+	size = xfs_dir2_block_sfsize(dp, block, &sfh);
+	if (!xfs_bmap_forkoff_grow(NULL, dp, size)) {
 		xfs_da_buf_done(bp);
 		return 0;
 	}
@@ -1002,8 +991,8 @@ xfs_dir2_leaf_to_block(
 	/*
 	 * Now see if the resulting block can be shrunken to shortform.
 	 */
-	if ((size = xfs_dir2_block_sfsize(dp, block, &sfh)) >
-	    XFS_IFORK_DSIZE(dp)) {
+	size = xfs_dir2_block_sfsize(dp, block, &sfh);
+	if (!xfs_bmap_forkoff_grow(NULL, dp, size)) {
 		error = 0;
 		goto out;
 	}
@@ -1228,5 +1217,6 @@ xfs_dir2_sf_to_block(
 	xfs_dir2_block_log_tail(tp, bp);
 	xfs_dir2_data_check(dp, bp);
 	xfs_da_buf_done(bp);
+	XFS_STATS_INC(xs_dir_sf_to_block);
 	return 0;
 }
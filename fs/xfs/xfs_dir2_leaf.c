@@ -857,10 +857,14 @@ xfs_dir2_leaf_getdents(
 					  mp->m_sb.sb_blocksize) - 1;
 
 			/*
-			 * If we don't have as many as we want, and we haven't
-			 * run out of data blocks, get some more mappings.
+			 * If we're down to half as many as we want, and we
+			 * haven't run out of data blocks, get some more
+			 * mappings.  Waiting until half the table is free
+			 * means each xfs_bmapi call fills in a batch of
+			 * mappings rather than the one or two freed up by
+			 * the last block.
 			 */
-			if (1 + ra_want > map_blocks &&
+			if (mp->m_dirblkfsbs + ra_want / 2 > map_blocks &&
 			    map_off <
 			    xfs_dir2_byte_to_da(mp, XFS_DIR2_LEAF_OFFSET)) {
 				/*
@@ -1335,6 +1339,8 @@ xfs_dir2_leaf_lookup_int(
 	xfs_trans_t		*tp;		/* transaction pointer */
 	xfs_dir2_db_t		cidb = -1;	/* case match data block no. */
 	enum xfs_dacmp		cmp;		/* name compare result */
+	int			count;		/* count of leaf entries */
+	__be32			bhash;		/* hash value, disk order */
 
 	dp = args->dp;
 	tp = args->trans;
@@ -1353,17 +1359,19 @@ xfs_dir2_leaf_lookup_int(
 	 * Look for the first leaf entry with our hash value.
 	 */
 	index = xfs_dir2_leaf_search_hash(args, lbp);
+	count = be16_to_cpu(leaf->hdr.count);
+	bhash = cpu_to_be32(args->hashval);
 	/*
 	 * Loop over all the entries with the right hash value
-	 * looking to match the name.
+	 * looking to match the name.  The hash values are compared
+	 * in disk order, so there is no byte swapping per entry.
 	 */
-	for (lep = &leaf->ents[index]; index < be16_to_cpu(leaf->hdr.count) &&
-				be32_to_cpu(lep->hashval) == args->hashval;
+	for (lep = &leaf->ents[index]; index < count && lep->hashval == bhash;
 				lep++, index++) {
 		/*
 		 * Skip over stale leaf entries.
 		 */
-		if (be32_to_cpu(lep->address) == XFS_DIR2_NULL_DATAPTR)
+		if (lep->address == cpu_to_be32(XFS_DIR2_NULL_DATAPTR))
 			continue;
 		/*
 		 * Get the new data block number.
@@ -1639,48 +1647,43 @@ xfs_dir2_leaf_search_hash(
 	xfs_da_args_t		*args,		/* operation arguments */
 	xfs_dabuf_t		*lbp)		/* leaf buffer */
 {
-	xfs_dahash_t		hash=0;		/* hash from this entry */
-	xfs_dahash_t		hashwant;	/* hash value looking for */
-	int			high;		/* high leaf index */
-	int			low;		/* low leaf index */
 	xfs_dir2_leaf_t		*leaf;		/* leaf structure */
-	xfs_dir2_leaf_entry_t	*lep;		/* leaf entry */
-	int			mid=0;		/* current leaf index */
 
 	leaf = lbp->data;
-#ifndef __KERNEL__
-	if (!leaf->hdr.count)
-		return 0;
-#endif
-	/*
-	 * Note, the table cannot be empty, so we have to go through the loop.
-	 * Binary search the leaf entries looking for our hash value.
-	 */
-	for (lep = leaf->ents, low = 0, high = be16_to_cpu(leaf->hdr.count) - 1,
-		hashwant = args->hashval;
-	     low <= high; ) {
+	return xfs_dir2_leaf_hash_index(leaf->ents,
+			be16_to_cpu(leaf->hdr.count), args->hashval);
+}
+
+/*
+ * Return the index of the first of count sorted leaf entries whose hash
+ * value is not lower than hash, or count if there is none.
+ *
+ * Halving stops once only a few entries are left; those are then scanned
+ * in order, which touches a single cache line and avoids the unpredictable
+ * branches at the bottom of the binary search.  Because this finds the
+ * lowest matching index directly, there is no need to back up through
+ * runs of equal hash values afterwards.
+ */
+int						/* index value */
+xfs_dir2_leaf_hash_index(
+	xfs_dir2_leaf_entry_t	*ents,		/* sorted leaf entries */
+	int			count,		/* number of entries */
+	xfs_dahash_t		hash)		/* hash value looking for */
+{
+	int			high;		/* high leaf index */
+	int			low;		/* low leaf index */
+	int			mid;		/* current leaf index */
+
+	for (low = 0, high = count; high - low > XFS_DIR2_LEAF_SCAN; ) {
 		mid = (low + high) >> 1;
-		if ((hash = be32_to_cpu(lep[mid].hashval)) == hashwant)
-			break;
-		if (hash < hashwant)
+		if (be32_to_cpu(ents[mid].hashval) < hash)
 			low = mid + 1;
 		else
-			high = mid - 1;
+			high = mid;
 	}
-	/*
-	 * Found one, back up through all the equal hash values.
-	 */
-	if (hash == hashwant) {
-		while (mid > 0 && be32_to_cpu(lep[mid - 1].hashval) == hashwant) {
-			mid--;
-		}
-	}
-	/*
-	 * Need to point to an entry higher than ours.
-	 */
-	else if (hash < hashwant)
-		mid++;
-	return mid;
+	while (low < high && be32_to_cpu(ents[low].hashval) < hash)
+		low++;
+	return low;
 }
 
 /*
@@ -1875,6 +1878,7 @@ xfs_dir2_node_to_leaf(
 		return error;
 	}
 	fbp = NULL;
+	xfs_dir2_fsum_free(dp);
 	/*
 	 * Now see if we can convert the single-leaf directory
 	 * down to a block form directory.
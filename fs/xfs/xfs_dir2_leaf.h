@@ -41,6 +41,11 @@ typedef	__uint32_t	xfs_dir2_dataptr_t;
 #define	XFS_DIR2_MAX_DATAPTR	((xfs_dir2_dataptr_t)0xffffffff)
 #define	XFS_DIR2_NULL_DATAPTR	((xfs_dir2_dataptr_t)0)
 
+/*
+ * Leaf hash searches scan linearly once this few entries are left.
+ */
+#define	XFS_DIR2_LEAF_SCAN	8
+
 /*
  * Leaf block header.
  */
@@ -246,6 +251,8 @@ extern int xfs_dir2_leaf_removename(struct xfs_da_args *args);
 extern int xfs_dir2_leaf_replace(struct xfs_da_args *args);
 extern int xfs_dir2_leaf_search_hash(struct xfs_da_args *args,
 				     struct xfs_dabuf *lbp);
+extern int xfs_dir2_leaf_hash_index(xfs_dir2_leaf_entry_t *ents, int count,
+				    xfs_dahash_t hash);
 extern int xfs_dir2_leaf_trim_data(struct xfs_da_args *args,
 				   struct xfs_dabuf *lbp, xfs_dir2_db_t db);
 extern int xfs_dir2_node_to_leaf(struct xfs_da_state *state);
@@ -98,6 +98,165 @@ xfs_dir2_free_log_header(
 		(uint)(sizeof(xfs_dir2_free_hdr_t) - 1));
 }
 
+/*
+ * In-core summary of the freespace index.
+ *
+ * To find a data block with room for a new entry, a node directory add
+ * would otherwise read every freespace block in turn and look at each
+ * bests[] entry, which gets slow once a directory has hundreds of
+ * thousands of data blocks.  Instead we keep the bests[] values of all
+ * data blocks as the leaves of a max tree indexed by data block number,
+ * so the lowest numbered block with enough room is found by walking down
+ * from the root.
+ *
+ * The tree is built by the first add that needs to search the freespace
+ * blocks and is kept in step with every change to a bests[] entry.  All
+ * of that happens under the exclusive directory ilock.  If memory for
+ * growing the tree can't be had it is simply dropped and rebuilt on the
+ * next search.  A missing data block or one without room has the value
+ * zero.
+ */
+typedef struct xfs_dir2_fsum {
+	int			fs_size;	/* leaves, a power of two */
+	__uint16_t		fs_max[1];	/* 2 * fs_size nodes from 1 */
+} xfs_dir2_fsum_t;
+
+#define	XFS_DIR2_FSUM_MINSIZE	64
+
+/*
+ * Make the summary large enough to hold data block db, dropping it if
+ * we can't.
+ */
+STATIC xfs_dir2_fsum_t *
+xfs_dir2_fsum_grow(
+	xfs_inode_t		*dp,		/* incore directory inode */
+	xfs_dir2_db_t		db)		/* data block to cover */
+{
+	xfs_dir2_fsum_t		*ofs = dp->i_dfsum;
+	xfs_dir2_fsum_t		*fs;
+	int			size;
+	int			i;
+
+	size = roundup_pow_of_two(max_t(int, db + 1, XFS_DIR2_FSUM_MINSIZE));
+	fs = kmem_zalloc(offsetof(xfs_dir2_fsum_t, fs_max) +
+			 2 * size * sizeof(__uint16_t),
+			 KM_LARGE | KM_NOFS | KM_MAYFAIL);
+	if (fs) {
+		fs->fs_size = size;
+		if (ofs) {
+			memcpy(&fs->fs_max[size], &ofs->fs_max[ofs->fs_size],
+			       ofs->fs_size * sizeof(__uint16_t));
+			for (i = size - 1; i > 0; i--)
+				fs->fs_max[i] = max(fs->fs_max[2 * i],
+						    fs->fs_max[2 * i + 1]);
+		}
+	}
+	if (ofs)
+		kmem_free(ofs);
+	dp->i_dfsum = fs;
+	return fs;
+}
+
+/*
+ * Record the bests[] value of data block db in the summary.
+ */
+void
+xfs_dir2_fsum_set(
+	xfs_inode_t		*dp,		/* incore directory inode */
+	xfs_dir2_db_t		db,		/* data block number */
+	int			best)		/* longest free, or NULLDATAOFF */
+{
+	xfs_dir2_fsum_t		*fs = dp->i_dfsum;
+	int			i;
+
+	if (!fs)
+		return;
+	if (db >= fs->fs_size && !(fs = xfs_dir2_fsum_grow(dp, db)))
+		return;
+	if (best == NULLDATAOFF)
+		best = 0;
+	i = fs->fs_size + db;
+	fs->fs_max[i] = best;
+	for (i >>= 1; i > 0; i >>= 1)
+		fs->fs_max[i] = max(fs->fs_max[2 * i], fs->fs_max[2 * i + 1]);
+}
+
+/*
+ * Find the lowest numbered data block with at least length bytes free,
+ * -1 if there is none.
+ */
+STATIC xfs_dir2_db_t
+xfs_dir2_fsum_find(
+	xfs_dir2_fsum_t		*fs,		/* freespace summary */
+	int			length)		/* space needed */
+{
+	int			i;
+
+	if (fs->fs_max[1] < length)
+		return -1;
+	for (i = 1; i < fs->fs_size; ) {
+		i <<= 1;
+		if (fs->fs_max[i] < length)
+			i++;
+	}
+	return i - fs->fs_size;
+}
+
+/*
+ * Read all the freespace blocks up to lastfbno into a new summary.
+ * The summary is left unset if memory is short.
+ */
+STATIC int					/* error */
+xfs_dir2_fsum_build(
+	xfs_da_args_t		*args,		/* operation arguments */
+	xfs_dir2_db_t		lastfbno)	/* end of the freespace blocks */
+{
+	xfs_inode_t		*dp = args->dp;
+	xfs_mount_t		*mp = dp->i_mount;
+	xfs_dir2_db_t		fbno;		/* freespace block number */
+	xfs_dabuf_t		*fbp;		/* freespace buffer */
+	xfs_dir2_free_t		*free;		/* freespace structure */
+	int			error;
+	int			i;
+
+	ASSERT(dp->i_dfsum == NULL);
+	if (!xfs_dir2_fsum_grow(dp, 0))
+		return 0;
+	for (fbno = XFS_DIR2_FREE_FIRSTDB(mp); fbno < lastfbno; fbno++) {
+		error = xfs_da_read_buf(args->trans, dp,
+				xfs_dir2_db_to_da(mp, fbno), -2, &fbp,
+				XFS_DATA_FORK);
+		if (error) {
+			xfs_dir2_fsum_free(dp);
+			return error;
+		}
+		if (unlikely(fbp == NULL))
+			continue;
+		free = fbp->data;
+		ASSERT(be32_to_cpu(free->hdr.magic) == XFS_DIR2_FREE_MAGIC);
+		for (i = 0; i < be32_to_cpu(free->hdr.nvalid); i++)
+			xfs_dir2_fsum_set(dp, be32_to_cpu(free->hdr.firstdb) + i,
+					  be16_to_cpu(free->bests[i]));
+		xfs_da_brelse(args->trans, fbp);
+		if (!dp->i_dfsum)
+			break;
+	}
+	return 0;
+}
+
+/*
+ * Free a directory's freespace summary.
+ */
+void
+xfs_dir2_fsum_free(
+	xfs_inode_t		*dp)		/* incore directory inode */
+{
+	if (dp->i_dfsum) {
+		kmem_free(dp->i_dfsum);
+		dp->i_dfsum = NULL;
+	}
+}
+
 /*
  * Convert a leaf-format directory to a node-format directory.
  * We need to change the magic number of the leaf block, and copy
@@ -172,6 +331,10 @@ xfs_dir2_leaf_to_node(
 	xfs_dir2_free_log_bests(tp, fbp, 0, be32_to_cpu(free->hdr.nvalid) - 1);
 	xfs_da_buf_done(fbp);
 	xfs_dir2_leafn_check(dp, lbp);
+	/*
+	 * The freespace summary is built again when it is next needed.
+	 */
+	xfs_dir2_fsum_free(dp);
 	return 0;
 }
 
@@ -1089,6 +1252,7 @@ xfs_dir2_leafn_remove(
 		 */
 		else {
 			free->bests[findex] = cpu_to_be16(longest);
+			xfs_dir2_fsum_set(dp, db, longest);
 			logfree = 1;
 		}
 		/*
@@ -1510,13 +1674,55 @@ xfs_dir2_node_addname_int(
 			return error;
 		lastfbno = xfs_dir2_da_to_db(mp, (xfs_dablk_t)fo);
 		fbno = ifbno;
+		/*
+		 * Ask the freespace summary first.  If it says no data
+		 * block has room we believe it and skip the search.
+		 */
+		if (!dp->i_dfsum &&
+		    (error = xfs_dir2_fsum_build(args, lastfbno))) {
+			if ((fblk == NULL || fblk->bp == NULL) && fbp != NULL)
+				xfs_da_buf_done(fbp);
+			return error;
+		}
+		if (dp->i_dfsum &&
+		    (dbno = xfs_dir2_fsum_find(dp->i_dfsum, length)) != -1) {
+			fbno = xfs_dir2_db_to_fdb(mp, dbno);
+			findex = xfs_dir2_db_to_fdindex(mp, dbno);
+			if (fbp && fbno != ifbno) {
+				xfs_da_brelse(tp, fbp);
+				fbp = NULL;
+				if (fblk && fblk->bp)
+					fblk->bp = NULL;
+			}
+			if (fbp == NULL &&
+			    (error = xfs_da_read_buf(tp, dp,
+					xfs_dir2_db_to_da(mp, fbno), -1, &fbp,
+					XFS_DATA_FORK)))
+				return error;
+			free = fbp->data;
+			ASSERT(be32_to_cpu(free->hdr.magic) == XFS_DIR2_FREE_MAGIC);
+			if (unlikely(findex >= be32_to_cpu(free->hdr.nvalid) ||
+				     be16_to_cpu(free->bests[findex]) == NULLDATAOFF ||
+				     be16_to_cpu(free->bests[findex]) < length)) {
+				/*
+				 * The summary is out of step with the disk.
+				 * Drop it and search the hard way from the
+				 * start of this freespace block.
+				 */
+				xfs_dir2_trace_args_sb("node_addname_fsum_stale",
+					args, findex, fbp);
+				xfs_dir2_fsum_free(dp);
+				dbno = -1;
+				findex = 0;
+			}
+		}
 	}
 	/*
 	 * While we haven't identified a data block, search the freeblock
 	 * data for a good data block.  If we find a null freeblock entry,
 	 * indicating a hole in the data blocks, remember that.
 	 */
-	while (dbno == -1) {
+	while (dbno == -1 && !dp->i_dfsum) {
 		/*
 		 * If we don't have a freeblock in hand, get the next one.
 		 */
@@ -1789,6 +1995,7 @@ xfs_dir2_node_addname_int(
 		free->bests[findex] = data->hdr.bestfree[0].length;
 		logfree = 1;
 	}
+	xfs_dir2_fsum_set(dp, dbno, be16_to_cpu(free->bests[findex]));
 	/*
 	 * Log the freespace entry if needed.
 	 */
@@ -33,6 +33,7 @@
 #include "xfs_dinode.h"
 #include "xfs_inode.h"
 #include "xfs_inode_item.h"
+#include "xfs_bmap.h"
 #include "xfs_error.h"
 #include "xfs_dir2_data.h"
 #include "xfs_dir2_leaf.h"
@@ -132,7 +133,7 @@ xfs_dir2_block_sfsize(
 		       (i8count ?				/* inumber */
 				(uint)sizeof(xfs_dir2_ino8_t) * count :
 				(uint)sizeof(xfs_dir2_ino4_t) * count);
-		if (size > XFS_IFORK_DSIZE(dp))
+		if (size > XFS_LITINO(mp))
 			return size;		/* size value is a failure */
 	}
 	/*
@@ -194,6 +195,7 @@ xfs_dir2_block_to_sf(
 	dp->i_df.if_flags |= XFS_IFINLINE;
 	dp->i_d.di_format = XFS_DINODE_FMT_LOCAL;
 	ASSERT(dp->i_df.if_bytes == 0);
+	xfs_bmap_forkoff_grow(args->trans, dp, size);
 	xfs_idata_realloc(dp, size, XFS_DATA_FORK);
 	logflags |= XFS_ILOG_DDATA;
 	/*
@@ -323,10 +325,11 @@ xfs_dir2_sf_addname(
 	old_isize = (int)dp->i_d.di_size;
 	new_isize = old_isize + incr_isize;
 	/*
-	 * Won't fit as shortform any more (due to size),
+	 * Won't fit as shortform any more (due to size, even after taking
+	 * any space the attribute fork can spare),
 	 * or the pick routine says it won't (due to offset values).
 	 */
-	if (new_isize > XFS_IFORK_DSIZE(dp) ||
+	if (!xfs_bmap_forkoff_grow(NULL, dp, new_isize) ||
 	    (pick =
 	     xfs_dir2_sf_addname_pick(args, objchange, &sfep, &offset)) == 0) {
 		/*
@@ -347,6 +350,10 @@ xfs_dir2_sf_addname(
 	 */
 	if (args->op_flags & XFS_DA_OP_JUSTCHECK)
 		return 0;
+	/*
+	 * Take the space from the attribute fork if we need it.
+	 */
+	xfs_bmap_forkoff_grow(args->trans, dp, new_isize);
 	/*
 	 * Do it the easy way - just add it at the end.
 	 */
@@ -1023,7 +1030,7 @@ xfs_dir2_sf_replace(
 		/*
 		 * Won't fit as shortform, convert to block then do replace.
 		 */
-		if (newsize > XFS_IFORK_DSIZE(dp)) {
+		if (!xfs_bmap_forkoff_grow(args->trans, dp, newsize)) {
 			error = xfs_dir2_sf_to_block(args);
 			if (error) {
 				return error;
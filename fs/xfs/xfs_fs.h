@@ -305,6 +305,33 @@ typedef struct xfs_fsop_bulkreq {
 	__s32		__user *ocount;	/* output count pointer		*/
 } xfs_fsop_bulkreq_t;
 
+/*
+ * Directory entries with their bulkstat data (XFS_IOC_READDIRPLUS).
+ * de_error is the error from stat'ing the entry, de_stat is only valid
+ * when it is zero.
+ */
+typedef struct xfs_direntplus {
+	__s64		de_off;		/* directory offset of entry	*/
+	__u64		de_ino;		/* inode number			*/
+	__s32		de_error;	/* errno from stat, or zero	*/
+	__u16		de_namelen;	/* length of de_name		*/
+	__u16		de_pad;		/* pad space, unused		*/
+	char		de_name[256];	/* null terminated entry name	*/
+	xfs_bstat_t	de_stat;	/* inode attributes		*/
+} xfs_direntplus_t;
+
+/*
+ * The user-level readdirplus request.  offset is the directory offset
+ * to start at and is updated to where the next call should start;
+ * ocount is zero once the end of the directory has been reached.
+ */
+typedef struct xfs_fsop_readdirplus {
+	__s64		offset;		/* directory offset in/out	*/
+	__s32		icount;		/* count of entries in buffer	*/
+	__s32		ocount;		/* count of entries returned	*/
+	xfs_direntplus_t __user *ubuffer; /* entry buffer		*/
+} xfs_fsop_readdirplus_t;
+
 
 /*
  * Structures returned from xfs_inumbers routine (XFS_IOC_FSINUMBERS).
@@ -380,6 +407,25 @@ typedef struct xfs_fsop_attrmulti_handlereq {
 	struct xfs_attr_multiop		__user *ops; /* attr_multi data */
 } xfs_fsop_attrmulti_handlereq_t;
 
+/*
+ * Attribute operations keyed by inode number (XFS_IOC_ATTRMULTI_BY_INO).
+ * Opcodes and flags are those of xfs_attr_multiop.
+ */
+typedef struct xfs_attr_inoop {
+	__u64		ai_ino;		/* inode number to operate on */
+	__u32		ai_opcode;	/* ATTR_OP_* */
+	__s32		ai_error;	/* result of this operation */
+	void		__user *ai_attrname;
+	void		__user *ai_attrvalue;
+	__u32		ai_length;
+	__u32		ai_flags;
+} xfs_attr_inoop_t;
+
+typedef struct xfs_fsop_attrmulti_inoreq {
+	__u32				opcount;/* count of following inoops */
+	struct xfs_attr_inoop		__user *ops; /* attr_multi data */
+} xfs_fsop_attrmulti_inoreq_t;
+
 /*
  * per machine unique filesystem identifier types.
  */
@@ -476,6 +522,8 @@ typedef struct xfs_handle {
 #define XFS_IOC_ATTRMULTI_BY_HANDLE  _IOW ('X', 123, struct xfs_fsop_attrmulti_handlereq)
 #define XFS_IOC_FSGEOMETRY	     _IOR ('X', 124, struct xfs_fsop_geom)
 #define XFS_IOC_GOINGDOWN	     _IOR ('X', 125, __uint32_t)
+#define XFS_IOC_READDIRPLUS	     _IOWR('X', 126, struct xfs_fsop_readdirplus)
+#define XFS_IOC_ATTRMULTI_BY_INO     _IOW ('X', 127, struct xfs_fsop_attrmulti_inoreq)
 /*	XFS_IOC_GETFSUUID ---------- deprecated 140	 */
 
 
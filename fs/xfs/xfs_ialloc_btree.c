@@ -350,7 +350,7 @@ xfs_inobt_init_cursor(
 	struct xfs_agi		*agi = XFS_BUF_TO_AGI(agbp);
 	struct xfs_btree_cur	*cur;
 
-	cur = kmem_zone_zalloc(xfs_btree_cur_zone, KM_SLEEP);
+	cur = xfs_btree_alloc_cursor(tp);
 
 	cur->bc_tp = tp;
 	cur->bc_mp = mp;
@@ -84,13 +84,19 @@ xfs_inode_alloc(
 	memset(&ip->i_imap, 0, sizeof(struct xfs_imap));
 	ip->i_afp = NULL;
 	memset(&ip->i_df, 0, sizeof(xfs_ifork_t));
+	ip->i_rmap.br_blockcount = 0;
+	ip->i_dcache = NULL;
+	ip->i_dfsum = NULL;
+	ip->i_acache = NULL;
 	ip->i_flags = 0;
 	ip->i_update_core = 0;
 	ip->i_update_size = 0;
+	ip->i_update_lazy = 0;
 	ip->i_delayed_blks = 0;
 	memset(&ip->i_d, 0, sizeof(xfs_icdinode_t));
 	ip->i_size = 0;
 	ip->i_new_size = 0;
+	ip->i_new_size_users = 0;
 
 	/*
 	 * Initialize inode's trace buffers.
@@ -50,6 +50,7 @@
 #include "xfs_dir2_trace.h"
 #include "xfs_quota.h"
 #include "xfs_acl.h"
+#include "xfs_attr.h"
 #include "xfs_filestream.h"
 #include "xfs_vnodeops.h"
 
@@ -2075,6 +2076,7 @@ xfs_ifree_cluster(
 
 			if (!iip) {
 				ip->i_update_core = 0;
+				ip->i_update_lazy = 0;
 				xfs_ifunlock(ip);
 				xfs_iunlock(ip, XFS_ILOCK_EXCL);
 				continue;
@@ -2446,9 +2448,85 @@ xfs_idestroy_fork(
 	if (whichfork == XFS_ATTR_FORK) {
 		kmem_zone_free(xfs_ifork_zone, ip->i_afp);
 		ip->i_afp = NULL;
+	} else {
+		xfs_irmap_inval(ip, 0, NULLFILEOFF);
 	}
 }
 
+/*
+ * Cached data fork read mapping.
+ *
+ * Read lookups through xfs_iomap() otherwise take the ilock shared and
+ * search the extent list for every readpage, readpages chunk and direct
+ * read, which stalls behind a writer holding the ilock exclusive across
+ * an allocation transaction.  We remember a copy of the last extent a
+ * read lookup returned so the next lookup that falls inside it needs
+ * neither the ilock nor the extent search.  Write and allocate lookups
+ * that find allocated blocks fill it in as well, and use it themselves
+ * when it maps real blocks, since they then have nothing to allocate.
+ *
+ * i_rmap_lock's sequence count doubles as the validity check: every
+ * data fork change invalidates the copy under the write side of the
+ * lock, so a reader that sees an unchanged sequence has a copy that no
+ * extent change has touched.
+ *
+ * The copy is set with the ilock held (at least shared) and is
+ * invalidated with the ilock held exclusive by anything that changes
+ * the data fork mappings of the range it covers, before that change is
+ * made.  A lockless lookup racing with such a change therefore sees
+ * either the old mapping or no mapping, exactly as if it had taken the
+ * ilock and dropped it again just before the change, which is what the
+ * callers of xfs_iomap() already have to cope with.
+ */
+int
+xfs_irmap_lookup(
+	xfs_inode_t	*ip,
+	xfs_fileoff_t	bno,
+	xfs_bmbt_irec_t	*imap)
+{
+	unsigned	seq;
+
+	do {
+		seq = read_seqbegin(&ip->i_rmap_lock);
+		*imap = ip->i_rmap;
+	} while (read_seqretry(&ip->i_rmap_lock, seq));
+
+	return imap->br_blockcount != 0 &&
+	       bno >= imap->br_startoff &&
+	       bno < imap->br_startoff + imap->br_blockcount;
+}
+
+void
+xfs_irmap_set(
+	xfs_inode_t	*ip,
+	xfs_bmbt_irec_t	*imap)
+{
+	ASSERT(xfs_isilocked(ip, XFS_ILOCK_EXCL|XFS_ILOCK_SHARED));
+
+	write_seqlock(&ip->i_rmap_lock);
+	ip->i_rmap = *imap;
+	write_sequnlock(&ip->i_rmap_lock);
+}
+
+/*
+ * Invalidate the cached read mapping if it overlaps [bno, end).
+ */
+void
+xfs_irmap_inval(
+	xfs_inode_t	*ip,
+	xfs_fileoff_t	bno,
+	xfs_fileoff_t	end)
+{
+	xfs_bmbt_irec_t	*imap = &ip->i_rmap;
+
+	write_seqlock(&ip->i_rmap_lock);
+	if (imap->br_blockcount != 0 &&
+	    imap->br_startoff < end &&
+	    imap->br_startoff + imap->br_blockcount > bno)
+		imap->br_blockcount = 0;
+	write_sequnlock(&ip->i_rmap_lock);
+}
+
 /*
  * This is called free all the memory associated with an inode.
  * It must free the inode itself and any buffers allocated for
@@ -2472,6 +2550,9 @@ xfs_idestroy(
 	}
 	if (ip->i_afp)
 		xfs_idestroy_fork(ip, XFS_ATTR_FORK);
+	xfs_dir2_hcache_free(ip);
+	xfs_dir2_fsum_free(ip);
+	xfs_attr_rcache_free(ip);
 
 #ifdef XFS_INODE_TRACE
 	ktrace_free(ip->i_trace);
@@ -2959,6 +3040,7 @@ xfs_iflush(
 	 */
 	if (XFS_FORCED_SHUTDOWN(mp)) {
 		ip->i_update_core = 0;
+		ip->i_update_lazy = 0;
 		if (iip)
 			iip->ili_format.ilf_fields = 0;
 		xfs_ifunlock(ip);
@@ -3114,6 +3196,7 @@ xfs_iflush_int(
 	 * the i_update_core access below the data copy below.
 	 */
 	ip->i_update_core = 0;
+	ip->i_update_lazy = 0;
 	SYNCHRONIZE();
 
 	/*
@@ -3885,6 +3968,22 @@ xfs_iext_inline_to_direct(
 	ifp->if_real_bytes = new_size;
 }
 
+/*
+ * Number of bytes actually allocated for an indirection array holding
+ * nlists entries.  Like the linear extent buffer, the array is kept at
+ * a power of two size so that files with thousands of extent pages do
+ * not reallocate and copy the whole array each time a page is added
+ * or removed.
+ */
+STATIC int
+xfs_iext_irec_bytes(
+	int		nlists)		/* number of irec's (ex lists) */
+{
+	if (nlists == 0)
+		return 0;
+	return roundup_pow_of_two(nlists) * (int)sizeof(xfs_ext_irec_t);
+}
+
 /*
  * Resize an extent indirection array to new_size bytes.
  */
@@ -3903,7 +4002,12 @@ xfs_iext_realloc_indirect(
 	ASSERT((new_size >= 0) && (new_size != size));
 	if (new_size == 0) {
 		xfs_iext_destroy(ifp);
-	} else {
+		return;
+	}
+	/* Only touch the allocation when the rounded size changes */
+	size = xfs_iext_irec_bytes(nlists);
+	new_size = xfs_iext_irec_bytes(new_size / sizeof(xfs_ext_irec_t));
+	if (new_size != size) {
 		ifp->if_u1.if_ext_irec = (xfs_ext_irec_t *)
 			kmem_realloc(ifp->if_u1.if_ext_irec,
 				new_size, size, KM_NOFS);
@@ -4071,6 +4175,7 @@ xfs_iext_bno_to_irec(
 			break;
 		}
 	}
+	xfs_iext_irec_extoffs(ifp, erp_idx);
 	*erp_idxp = erp_idx;
 	return erp;
 }
@@ -4102,7 +4207,20 @@ xfs_iext_idx_to_irec(
 	nlists = ifp->if_real_bytes / XFS_IEXT_BUFSZ;
 	erp_idx = 0;
 	low = 0;
-	high = nlists - 1;
+
+	/*
+	 * Bring er_extoff up to date far enough to cover page_idx.  Every
+	 * irec past the last one made valid here starts beyond page_idx,
+	 * so the search never needs to look at them.
+	 */
+	erp = ifp->if_u1.if_ext_irec;
+	while (ifp->if_extoff_valid < nlists) {
+		prev = &erp[ifp->if_extoff_valid - 1];
+		if (prev->er_extoff + prev->er_extcount > page_idx)
+			break;
+		xfs_iext_irec_extoffs(ifp, ifp->if_extoff_valid);
+	}
+	high = ifp->if_extoff_valid - 1;
 
 	/* Binary search extent irec's */
 	while (low <= high) {
@@ -4162,6 +4280,7 @@ xfs_iext_irec_init(
 	erp->er_extoff = 0;
 
 	ifp->if_flags |= XFS_IFEXTIREC;
+	ifp->if_extoff_valid = 1;
 	ifp->if_real_bytes = XFS_IEXT_BUFSZ;
 	ifp->if_bytes = nextents * sizeof(xfs_bmbt_rec_t);
 	ifp->if_u1.if_ext_irec = erp;
@@ -4178,11 +4297,13 @@ xfs_iext_irec_new(
 	int		erp_idx)	/* index for new irec */
 {
 	xfs_ext_irec_t	*erp;		/* indirection array pointer */
-	int		i;		/* loop counter */
 	int		nlists;		/* number of irec's (ex lists) */
 
 	ASSERT(ifp->if_flags & XFS_IFEXTIREC);
 	nlists = ifp->if_real_bytes / XFS_IEXT_BUFSZ;
+	ASSERT(erp_idx <= nlists);
+	if (erp_idx > 0)
+		xfs_iext_irec_extoffs(ifp, erp_idx - 1);
 
 	/* Resize indirection array */
 	xfs_iext_realloc_indirect(ifp, ++nlists *
@@ -4192,10 +4313,10 @@ xfs_iext_irec_new(
 	 * new page can use erp_idx.
 	 */
 	erp = ifp->if_u1.if_ext_irec;
-	for (i = nlists - 1; i > erp_idx; i--) {
-		memmove(&erp[i], &erp[i-1], sizeof(xfs_ext_irec_t));
+	if (erp_idx < nlists - 1) {
+		memmove(&erp[erp_idx + 1], &erp[erp_idx],
+			(nlists - 1 - erp_idx) * sizeof(xfs_ext_irec_t));
 	}
-	ASSERT(i == erp_idx);
 
 	/* Initialize new extent record */
 	erp = ifp->if_u1.if_ext_irec;
@@ -4205,6 +4326,11 @@ xfs_iext_irec_new(
 	erp[erp_idx].er_extcount = 0;
 	erp[erp_idx].er_extoff = erp_idx > 0 ?
 		erp[erp_idx-1].er_extoff + erp[erp_idx-1].er_extcount : 0;
+	/*
+	 * The new page is empty, so the irecs moved up past it keep
+	 * their offsets.
+	 */
+	ifp->if_extoff_valid++;
 	return (&erp[erp_idx]);
 }
 
@@ -4217,7 +4343,6 @@ xfs_iext_irec_remove(
 	int		erp_idx)	/* irec index to remove */
 {
 	xfs_ext_irec_t	*erp;		/* indirection array pointer */
-	int		i;		/* loop counter */
 	int		nlists;		/* number of irec's (ex lists) */
 
 	ASSERT(ifp->if_flags & XFS_IFEXTIREC);
@@ -4230,9 +4355,14 @@ xfs_iext_irec_remove(
 	}
 	/* Compact extent records */
 	erp = ifp->if_u1.if_ext_irec;
-	for (i = erp_idx; i < nlists - 1; i++) {
-		memmove(&erp[i], &erp[i+1], sizeof(xfs_ext_irec_t));
+	if (erp_idx < nlists - 1) {
+		memmove(&erp[erp_idx], &erp[erp_idx + 1],
+			(nlists - 1 - erp_idx) * sizeof(xfs_ext_irec_t));
 	}
+	if (ifp->if_extoff_valid > erp_idx)
+		ifp->if_extoff_valid--;
+	if (ifp->if_extoff_valid == 0)
+		ifp->if_extoff_valid = 1;
 	/*
 	 * Manually free the last extent record from the indirection
 	 * array.  A call to xfs_iext_realloc_indirect() with a size
@@ -4321,11 +4451,12 @@ xfs_iext_irec_compact_pages(
 }
 
 /*
- * This is called to update the er_extoff field in the indirection
- * array when extents have been added or removed from one of the
- * extent lists. erp_idx contains the irec index to begin updating
- * at and ext_diff contains the number of extents that were added
- * or removed.
+ * This is called when extents have been added to or removed from one of
+ * the extent lists.  erp_idx is the first irec whose er_extoff is now
+ * stale.  Rather than walking every later irec on each insert or remove,
+ * just pull back the valid mark; xfs_iext_irec_extoffs() brings the
+ * offsets up to date again as lookups reach them.  ext_diff is the number
+ * of extents that were added or removed and is only kept for the callers.
  */
 void
 xfs_iext_irec_update_extoffs(
@@ -4333,12 +4464,29 @@ xfs_iext_irec_update_extoffs(
 	int		erp_idx,	/* irec index to update */
 	int		ext_diff)	/* number of new extents */
 {
+	ASSERT(ifp->if_flags & XFS_IFEXTIREC);
+	ASSERT(erp_idx > 0);
+	if (erp_idx < ifp->if_extoff_valid)
+		ifp->if_extoff_valid = erp_idx;
+}
+
+/*
+ * Recompute er_extoff for every stale irec up to and including erp_idx.
+ * Offsets are a running sum of the extent counts of the preceding pages.
+ */
+void
+xfs_iext_irec_extoffs(
+	xfs_ifork_t	*ifp,		/* inode fork pointer */
+	int		erp_idx)	/* last irec index needed */
+{
+	xfs_ext_irec_t	*erp;		/* indirection array pointer */
 	int		i;		/* loop counter */
-	int		nlists;		/* number of irec's (ex lists */
 
 	ASSERT(ifp->if_flags & XFS_IFEXTIREC);
-	nlists = ifp->if_real_bytes / XFS_IEXT_BUFSZ;
-	for (i = erp_idx; i < nlists; i++) {
-		ifp->if_u1.if_ext_irec[i].er_extoff += ext_diff;
-	}
+	ASSERT(erp_idx < ifp->if_real_bytes / XFS_IEXT_BUFSZ);
+	erp = ifp->if_u1.if_ext_irec;
+	for (i = ifp->if_extoff_valid; i <= erp_idx; i++)
+		erp[i].er_extoff = erp[i-1].er_extoff + erp[i-1].er_extcount;
+	if (i > ifp->if_extoff_valid)
+		ifp->if_extoff_valid = i;
 }
@@ -67,6 +67,7 @@ typedef struct xfs_ifork {
 	unsigned char		if_flags;	/* per-fork flags */
 	unsigned char		if_ext_max;	/* max # of extent records */
 	xfs_extnum_t		if_lastex;	/* last if_extents used */
+	int			if_extoff_valid;/* irecs with current er_extoff */
 	union {
 		xfs_bmbt_rec_host_t *if_extents;/* linear map file exts */
 		xfs_ext_irec_t	*if_ext_irec;	/* irec map file exts */
@@ -157,6 +158,7 @@ typedef struct xfs_icdinode {
  */
 #define	XFS_ICHGTIME_MOD	0x1	/* data fork modification timestamp */
 #define	XFS_ICHGTIME_CHG	0x2	/* inode field change timestamp */
+#define	XFS_ICHGTIME_LAZY	0x4	/* data path, may be written lazily */
 
 /*
  * Per-fork incore inode flags.
@@ -258,16 +260,23 @@ typedef struct xfs_inode {
 	atomic_t		i_pincount;	/* inode pin count */
 	wait_queue_head_t	i_ipin_wait;	/* inode pinning wait queue */
 	spinlock_t		i_flags_lock;	/* inode i_flags lock */
+	seqlock_t		i_rmap_lock;	/* protects i_rmap */
+	xfs_bmbt_irec_t		i_rmap;		/* last data fork read map */
+	struct xfs_dir2_hcache	*i_dcache;	/* dir lookup cache */
+	struct xfs_dir2_fsum	*i_dfsum;	/* dir freespace summary */
+	struct xfs_attr_rcache	*i_acache;	/* remote attr value cache */
 	/* Miscellaneous state. */
 	unsigned short		i_flags;	/* see defined flags below */
 	unsigned char		i_update_core;	/* timestamps/size is dirty */
 	unsigned char		i_update_size;	/* di_size field is dirty */
+	unsigned char		i_update_lazy;	/* only lazy timestamps dirty */
 	unsigned int		i_delayed_blks;	/* count of delay alloc blks */
 
 	xfs_icdinode_t		i_d;		/* most of ondisk inode */
 
 	xfs_fsize_t		i_size;		/* in-memory size */
 	xfs_fsize_t		i_new_size;	/* size when write completes */
+	unsigned int		i_new_size_users; /* writers past i_size */
 	atomic_t		i_iocount;	/* outstanding I/O count */
 
 	/* VFS inode */
@@ -414,6 +423,8 @@ static inline void xfs_ifunlock(xfs_inode_t *ip)
 #define XFS_IMODIFIED	0x0100	/* XFS inode state possibly differs */
 				/* to the Linux inode state. */
 #define XFS_ITRUNCATED	0x0200	/* truncated down so flush-on-close */
+#define XFS_IEOFBLOCKS	0x0400	/* has speculative prealloc beyond EOF */
+#define XFS_IEOFRECENT	0x0800	/* prealloc extended since last trim scan */
 
 /*
  * Flags for inode locking.
@@ -558,6 +569,11 @@ void		xfs_dinode_from_disk(struct xfs_icdinode *,
 void		xfs_dinode_to_disk(struct xfs_dinode *,
 				   struct xfs_icdinode *);
 void		xfs_idestroy_fork(struct xfs_inode *, int);
+int		xfs_irmap_lookup(struct xfs_inode *, xfs_fileoff_t,
+				 xfs_bmbt_irec_t *);
+void		xfs_irmap_set(struct xfs_inode *, xfs_bmbt_irec_t *);
+void		xfs_irmap_inval(struct xfs_inode *, xfs_fileoff_t,
+				xfs_fileoff_t);
 void		xfs_idata_realloc(struct xfs_inode *, int, int);
 void		xfs_iroot_realloc(struct xfs_inode *, int, int);
 int		xfs_iread_extents(struct xfs_trans *, struct xfs_inode *, int);
@@ -588,6 +604,7 @@ void		xfs_iext_irec_compact(xfs_ifork_t *);
 void		xfs_iext_irec_compact_pages(xfs_ifork_t *);
 void		xfs_iext_irec_compact_full(xfs_ifork_t *);
 void		xfs_iext_irec_update_extoffs(xfs_ifork_t *, int, int);
+void		xfs_iext_irec_extoffs(xfs_ifork_t *, int);
 
 #define xfs_ipincount(ip)	((unsigned int) atomic_read(&ip->i_pincount))
 
@@ -259,6 +259,7 @@ xfs_inode_item_format(
 	 */
 	if (ip->i_update_core)  {
 		ip->i_update_core = 0;
+		ip->i_update_lazy = 0;
 		SYNCHRONIZE();
 	}
 
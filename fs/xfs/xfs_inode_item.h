@@ -88,6 +88,14 @@ typedef struct xfs_inode_log_format_64 {
 #define	XFS_ILOG_AEXT	0x080	/* log i_af.if_extents */
 #define	XFS_ILOG_ABROOT	0x100	/* log i_af.i_broot */
 
+/*
+ * In-core only flag for xfs_trans_log_inode: the transaction changed
+ * nothing but timestamps.  It is logged as XFS_ILOG_CORE and never
+ * reaches ilf_fields; it only tells fdatasync that the change can be
+ * ignored.
+ */
+#define	XFS_ILOG_TIMESTAMP	0x4000
+
 #define	XFS_ILOG_NONCORE	(XFS_ILOG_DDATA | XFS_ILOG_DEXT | \
 				 XFS_ILOG_DBROOT | XFS_ILOG_DEV | \
 				 XFS_ILOG_UUID | XFS_ILOG_ADATA | \
@@ -148,6 +156,8 @@ typedef struct xfs_inode_log_item {
 	unsigned short		ili_flags;	   /* misc flags */
 	unsigned short		ili_logged;	   /* flushed logged data */
 	unsigned int		ili_last_fields;   /* fields when flushed */
+	unsigned int		ili_fsync_fields;  /* fields logged since
+						      last fsync */
 	struct xfs_bmbt_rec_64	*ili_extents_buf;  /* array of logged
 						      data exts */
 	struct xfs_bmbt_rec_64	*ili_aextents_buf; /* array of logged
@@ -165,6 +165,26 @@ xfs_imap_to_bmap(
 	return pbm;	/* Return the number filled */
 }
 
+/*
+ * Look up the cached data fork mapping for a write or allocate lookup.
+ * Those only need the extent list when something has to be allocated,
+ * so only a cached mapping of real blocks is good enough for them.
+ */
+STATIC int
+xfs_iomap_cached_alloc(
+	xfs_inode_t	*ip,
+	xfs_fileoff_t	offset_fsb,
+	xfs_bmbt_irec_t	*imap)
+{
+	if (xfs_irmap_lookup(ip, offset_fsb, imap) &&
+	    !ISNULLSTARTBLOCK(imap->br_startblock)) {
+		XFS_STATS_INC(xs_iomapc_hit);
+		return 1;
+	}
+	XFS_STATS_INC(xs_iomapc_miss);
+	return 0;
+}
+
 int
 xfs_iomap(
 	xfs_inode_t	*ip,
@@ -188,14 +208,41 @@ xfs_iomap(
 	if (XFS_FORCED_SHUTDOWN(mp))
 		return XFS_ERROR(EIO);
 
+	ASSERT(offset <= mp->m_maxioffset);
+	if ((xfs_fsize_t)offset + count > mp->m_maxioffset)
+		count = mp->m_maxioffset - offset;
+	end_fsb = XFS_B_TO_FSB(mp, (xfs_ufsize_t)offset + count);
+	offset_fsb = XFS_B_TO_FSBT(mp, offset);
+
 	switch (flags & (BMAPI_READ | BMAPI_WRITE | BMAPI_ALLOCATE)) {
 	case BMAPI_READ:
 		xfs_iomap_enter_trace(XFS_IOMAP_READ_ENTER, ip, offset, count);
+		/*
+		 * If the last mapping handed out for a read still covers
+		 * this offset, we need neither the ilock nor the extent
+		 * list.  See xfs_irmap_lookup().
+		 */
+		if (xfs_irmap_lookup(ip, offset_fsb, &imap)) {
+			XFS_STATS_INC(xs_iomapc_hit);
+			goto out_map;
+		}
+		XFS_STATS_INC(xs_iomapc_miss);
 		lockmode = xfs_ilock_map_shared(ip);
 		bmapi_flags = XFS_BMAPI_ENTIRE;
 		break;
 	case BMAPI_WRITE:
 		xfs_iomap_enter_trace(XFS_IOMAP_WRITE_ENTER, ip, offset, count);
+		/*
+		 * A write over blocks that are already allocated has nothing
+		 * to allocate, so a cached mapping will do as long as we do
+		 * not have to merge unwritten and written extents for it.
+		 */
+		if (!(flags & BMAPI_IGNSTATE) &&
+		    xfs_iomap_cached_alloc(ip, offset_fsb, &imap)) {
+			xfs_iomap_map_trace(XFS_IOMAP_WRITE_MAP, ip,
+					offset, count, iomapp, &imap, flags);
+			goto out_map;
+		}
 		lockmode = XFS_ILOCK_EXCL;
 		if (flags & BMAPI_IGNSTATE)
 			bmapi_flags |= XFS_BMAPI_IGSTATE|XFS_BMAPI_ENTIRE;
@@ -203,6 +250,11 @@ xfs_iomap(
 		break;
 	case BMAPI_ALLOCATE:
 		xfs_iomap_enter_trace(XFS_IOMAP_ALLOC_ENTER, ip, offset, count);
+		if (xfs_iomap_cached_alloc(ip, offset_fsb, &imap)) {
+			xfs_iomap_map_trace(XFS_IOMAP_WRITE_MAP, ip,
+					offset, count, iomapp, &imap, flags);
+			goto out_map;
+		}
 		lockmode = XFS_ILOCK_SHARED;
 		bmapi_flags = XFS_BMAPI_ENTIRE;
 
@@ -218,12 +270,6 @@ xfs_iomap(
 		BUG();
 	}
 
-	ASSERT(offset <= mp->m_maxioffset);
-	if ((xfs_fsize_t)offset + count > mp->m_maxioffset)
-		count = mp->m_maxioffset - offset;
-	end_fsb = XFS_B_TO_FSB(mp, (xfs_ufsize_t)offset + count);
-	offset_fsb = XFS_B_TO_FSBT(mp, offset);
-
 	error = xfs_bmapi(NULL, ip, offset_fsb,
 			(xfs_filblks_t)(end_fsb - offset_fsb),
 			bmapi_flags,  NULL, 0, &imap,
@@ -232,12 +278,18 @@ xfs_iomap(
 	if (error)
 		goto out;
 
-	switch (flags & (BMAPI_WRITE|BMAPI_ALLOCATE)) {
+	switch (flags & (BMAPI_READ|BMAPI_WRITE|BMAPI_ALLOCATE)) {
+	case BMAPI_READ:
+		if (nimaps)
+			xfs_irmap_set(ip, &imap);
+		break;
 	case BMAPI_WRITE:
 		/* If we found an extent, return it */
 		if (nimaps &&
 		    (imap.br_startblock != HOLESTARTBLOCK) &&
 		    (imap.br_startblock != DELAYSTARTBLOCK)) {
+			if (!(flags & BMAPI_IGNSTATE))
+				xfs_irmap_set(ip, &imap);
 			xfs_iomap_map_trace(XFS_IOMAP_WRITE_MAP, ip,
 					offset, count, iomapp, &imap, flags);
 			break;
@@ -258,6 +310,8 @@ xfs_iomap(
 		break;
 	case BMAPI_ALLOCATE:
 		/* If we found an extent, return it */
+		if (nimaps && !ISNULLSTARTBLOCK(imap.br_startblock))
+			xfs_irmap_set(ip, &imap);
 		xfs_iunlock(ip, lockmode);
 		lockmode = 0;
 
@@ -272,6 +326,7 @@ xfs_iomap(
 		break;
 	}
 
+out_map:
 	if (nimaps) {
 		*niomaps = xfs_imap_to_bmap(ip, offset, &imap,
 					    iomapp, nimaps, *niomaps, iomap_flags);
@@ -491,8 +546,16 @@ xfs_iomap_write_direct(
 	xfs_trans_ijoin(tp, ip, XFS_ILOCK_EXCL);
 	xfs_trans_ihold(tp, ip);
 
+	/*
+	 * Blocks allocated inside EOF must not expose stale data before the
+	 * write lands, so they are allocated unwritten and converted at I/O
+	 * completion.  The same applies beyond EOF when several direct
+	 * writers are extending the file at once: one of them can move EOF
+	 * past blocks another has allocated but not yet written.
+	 */
 	bmapi_flag = XFS_BMAPI_WRITE;
-	if ((flags & BMAPI_DIRECT) && (offset < ip->i_size || extsz))
+	if ((flags & BMAPI_DIRECT) &&
+	    (offset < ip->i_size || extsz || ip->i_new_size_users > 1))
 		bmapi_flag |= XFS_BMAPI_PREALLOC;
 
 	/*
@@ -601,6 +664,47 @@ xfs_iomap_eof_want_preallocate(
 	return 0;
 }
 
+/*
+ * Size the speculative preallocation beyond EOF for a delayed allocation
+ * write.  Unless a fixed size was set with the allocsize mount option,
+ * scale it with the current file size, rounded down to a power of two
+ * and capped at the largest extent we can allocate, so that files which
+ * keep growing are laid out in ever larger extents.  Back off as the
+ * filesystem fills up so speculative space does not cause early ENOSPC,
+ * and never go below the default write I/O size.
+ */
+STATIC xfs_extlen_t
+xfs_iomap_prealloc_size(
+	xfs_mount_t	*mp,
+	xfs_fsize_t	isize)
+{
+	xfs_fsblock_t	alloc_blocks = 0;
+	__uint64_t	lowsp;
+	int		shift = 0;
+	int		pct;
+
+	if (!(mp->m_flags & XFS_MOUNT_DFLT_IOSIZE)) {
+		alloc_blocks = XFS_B_TO_FSB(mp, isize);
+		alloc_blocks = XFS_FILBLKS_MIN(alloc_blocks, MAXEXTLEN);
+		if (alloc_blocks)
+			alloc_blocks = rounddown_pow_of_two(alloc_blocks);
+
+		xfs_icsb_sync_counters(mp, XFS_ICSB_LAZY_COUNT);
+		lowsp = mp->m_sb.sb_dblocks;
+		do_div(lowsp, 100);
+		for (pct = 5; pct > 0; pct--) {
+			if (mp->m_sb.sb_fdblocks >= lowsp * pct)
+				break;
+			shift = shift ? shift + 1 : 2;
+		}
+		alloc_blocks >>= shift;
+	}
+
+	if (alloc_blocks < mp->m_writeio_blocks)
+		alloc_blocks = mp->m_writeio_blocks;
+	return alloc_blocks;
+}
+
 int
 xfs_iomap_write_delay(
 	xfs_inode_t	*ip,
@@ -649,7 +753,11 @@ retry:
 	if (prealloc) {
 		aligned_offset = XFS_WRITEIO_ALIGN(mp, (offset + count - 1));
 		ioalign = XFS_B_TO_FSBT(mp, aligned_offset);
-		last_fsb = ioalign + mp->m_writeio_blocks;
+		/* stick to the minimum once we have had to flush for space */
+		if (fsynced)
+			last_fsb = ioalign + mp->m_writeio_blocks;
+		else
+			last_fsb = ioalign + xfs_iomap_prealloc_size(mp, isize);
 	} else {
 		last_fsb = XFS_B_TO_FSB(mp, ((xfs_ufsize_t)(offset + count)));
 	}
@@ -688,6 +796,13 @@ retry:
 	if (!(imap[0].br_startblock || XFS_IS_REALTIME_INODE(ip)))
 		return xfs_cmn_err_fsblock_zero(ip, &imap[0]);
 
+	/*
+	 * Let the background scanner know there are speculative blocks
+	 * beyond EOF, and that they are still in active use.
+	 */
+	if (prealloc && last_fsb > XFS_B_TO_FSB(mp, offset + count))
+		xfs_inode_set_eofblocks_tag(ip);
+
 	*ret_imap = imap[0];
 	*nmaps = 1;
 
@@ -97,6 +97,8 @@ STATIC int xlog_regrant_write_log_space(xlog_t		*log,
 					 xlog_ticket_t  *ticket);
 STATIC void xlog_ungrant_log_space(xlog_t	 *log,
 				   xlog_ticket_t *ticket);
+STATIC void xlog_tic_usage_update(xlog_t	 *log,
+				  xlog_ticket_t *ticket);
 
 
 /* local ticket functions */
@@ -358,6 +360,8 @@ xfs_log_done(xfs_mount_t	*mp,
 		 * request has been made to release a permanent reservation.
 		 */
 		xlog_trace_loggrant(log, ticket, "xfs_log_done: (non-permanent)");
+		if (ticket->t_flags & XLOG_TIC_PERM_RESERV)
+			xlog_tic_usage_update(log, ticket);
 		xlog_ungrant_log_space(log, ticket);
 		xfs_log_ticket_put(ticket);
 	} else {
@@ -532,6 +536,69 @@ xfs_log_reserve(xfs_mount_t	 *mp,
 	return retval;
 }	/* xfs_log_reserve */
 
+/*
+ * Return the number of units a new permanent reservation of the given
+ * transaction type should ask for up front, given the caller's count.
+ *
+ * The log count of a rolling transaction is sized for the worst case
+ * number of rolls, and all of those units are taken from both grant heads
+ * when the ticket is allocated.  Most transactions roll fewer times than
+ * that, so when the log is small relative to the workload the unused
+ * units needlessly hold other reservations off.  Once we have seen enough
+ * tickets of a type, ask only for the recently observed peak.  Asking for
+ * fewer units is always safe: a ticket that rolls more often than its
+ * count simply regrants a unit at a time in xlog_regrant_write_log_space(),
+ * exactly as long-running truncates already do.  The unit size itself is
+ * never reduced, as running out of that is fatal in xlog_write().
+ */
+int
+xfs_log_adapt_count(
+	xfs_mount_t	*mp,
+	uint		t_type,
+	int		cnt)
+{
+	xlog_tic_usage_t *tu;
+	int		want;
+
+	if (!xfs_adapt_logcount || t_type >= XFS_TRANS_TYPE_MAX)
+		return cnt;
+
+	/*
+	 * Lockless read; this is a hint and a stale value only means we
+	 * reserve a little more or less than we could have.
+	 */
+	tu = &mp->m_log->l_tic_usage[t_type];
+	if (tu->tu_prev_peak == 0)
+		return cnt;
+	want = max(tu->tu_peak, tu->tu_prev_peak);
+	return min(cnt, max(want, 1));
+}
+
+/*
+ * Record how many units of a permanent reservation this ticket used.
+ */
+STATIC void
+xlog_tic_usage_update(
+	xlog_t		*log,
+	xlog_ticket_t	*ticket)
+{
+	xlog_tic_usage_t *tu;
+
+	if (ticket->t_trans_type >= XFS_TRANS_TYPE_MAX)
+		return;
+	tu = &log->l_tic_usage[ticket->t_trans_type];
+
+	spin_lock(&log->l_grant_lock);
+	if (ticket->t_units > tu->tu_peak)
+		tu->tu_peak = ticket->t_units;
+	if (++tu->tu_count >= XLOG_TIC_USAGE_WINDOW) {
+		tu->tu_prev_peak = tu->tu_peak;
+		tu->tu_peak = 0;
+		tu->tu_count = 0;
+	}
+	spin_unlock(&log->l_grant_lock);
+}
+
 
 /*
  * Mount a log filesystem
@@ -2777,6 +2844,7 @@ xlog_regrant_reserve_log_space(xlog_t	     *log,
 			    "xlog_regrant_reserve_log_space: enter");
 	if (ticket->t_cnt > 0)
 		ticket->t_cnt--;
+	ticket->t_units++;
 
 	spin_lock(&log->l_grant_lock);
 	xlog_grant_sub_space(log, ticket->t_curr_res);
@@ -3321,6 +3389,7 @@ xlog_ticket_alloc(xlog_t		*log,
 	tic->t_clientid		= client;
 	tic->t_flags		= XLOG_TIC_INITED;
 	tic->t_trans_type	= 0;
+	tic->t_units		= 1;
 	if (xflags & XFS_LOG_PERM_RESERV)
 		tic->t_flags |= XLOG_TIC_PERM_RESERV;
 	sv_init(&(tic->t_wait), SV_DEFAULT, "logtick");
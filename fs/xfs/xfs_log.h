@@ -165,6 +165,9 @@ int	  xfs_log_reserve(struct xfs_mount *mp,
 			  __uint8_t	   clientid,
 			  uint		   flags,
 			  uint		   t_type);
+int	  xfs_log_adapt_count(struct xfs_mount *mp,
+			  uint		   t_type,
+			  int		   count);
 int	  xfs_log_write(struct xfs_mount *mp,
 			xfs_log_iovec_t  region[],
 			int		 nentries,
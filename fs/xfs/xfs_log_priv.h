@@ -253,6 +253,7 @@ typedef struct xlog_ticket {
 	char		   t_clientid;	 /* who does this belong to;	 : 1  */
 	char		   t_flags;	 /* properties of reservation	 : 1  */
 	uint		   t_trans_type; /* transaction type             : 4  */
+	uint		   t_units;	 /* reservation units consumed   : 4  */
 
         /* reservation array fields */
 	uint		   t_res_num;                    /* num in array : 4 */
@@ -376,6 +377,21 @@ typedef struct xlog_in_core {
 #define ic_header	ic_data->hic_header
 } xlog_in_core_t;
 
+/*
+ * Per transaction type record of how many units of a permanent log
+ * reservation are actually consumed before the ticket is released.  The
+ * peak is tracked over a window of XLOG_TIC_USAGE_WINDOW tickets and the
+ * previous window's peak is kept so the estimate decays rather than drops
+ * to zero when a new window starts.
+ */
+#define XLOG_TIC_USAGE_WINDOW	256
+
+typedef struct xlog_tic_usage {
+	uint		tu_peak;	/* peak units used, current window */
+	uint		tu_prev_peak;	/* peak units used, last window */
+	uint		tu_count;	/* tickets seen in current window */
+} xlog_tic_usage_t;
+
 /*
  * The reservation head lsn is not made up of a cycle number and block number.
  * Instead, it uses a cycle number and byte number.  Logs don't expect to
@@ -428,6 +444,7 @@ typedef struct log {
 	int			l_grant_reserve_bytes;
 	int			l_grant_write_cycle;
 	int			l_grant_write_bytes;
+	xlog_tic_usage_t	l_tic_usage[XFS_TRANS_TYPE_MAX];
 
 #ifdef XFS_LOG_TRACE
 	struct ktrace		*l_grant_trace;
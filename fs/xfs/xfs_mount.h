@@ -329,6 +329,8 @@ typedef struct xfs_mount {
 	struct list_head	m_sync_list;	/* sync thread work item list */
 	spinlock_t		m_sync_lock;	/* work item list lock */
 	int			m_sync_seq;	/* sync thread generation no. */
+	unsigned long		m_eofb_stamp;	/* last post-EOF trim scan */
+	unsigned long		m_lazytime_stamp; /* last lazy timestamp flush */
 	wait_queue_head_t	m_wait_single_sync_task;
 #ifdef HAVE_DMAPI
 	struct vfsmount		*m_vfsmount;
@@ -375,6 +377,8 @@ typedef struct xfs_mount {
 #define XFS_MOUNT_FILESTREAMS	(1ULL << 24)	/* enable the filestreams
 						   allocator */
 #define XFS_MOUNT_NOATTR2	(1ULL << 25)	/* disable use of attr2 format */
+#define XFS_MOUNT_LAZYTIME	(1ULL << 26)	/* write back data timestamps
+						   lazily */
 
 
 /*
@@ -327,6 +327,7 @@ xfs_trans_reserve(
 	uint		logcount)
 {
 	int		log_flags;
+	int		log_count;
 	int		error = 0;
 	int		rsvd = (tp->t_flags & XFS_TRANS_RESERVE) != 0;
 
@@ -364,7 +365,18 @@ xfs_trans_reserve(
 			log_flags = 0;
 		}
 
-		error = xfs_log_reserve(tp->t_mountp, logspace, logcount,
+		/*
+		 * A new permanent reservation may ask for fewer units than
+		 * the worst case count if this transaction type has been
+		 * observed to roll less often; see xfs_log_adapt_count().
+		 * Rolls past the reserved count regrant a unit at a time.
+		 */
+		log_count = logcount;
+		if ((flags & XFS_TRANS_PERM_LOG_RES) && tp->t_ticket == NULL)
+			log_count = xfs_log_adapt_count(tp->t_mountp,
+							tp->t_type, logcount);
+
+		error = xfs_log_reserve(tp->t_mountp, logspace, log_count,
 					&tp->t_ticket,
 					XFS_TRANSACTION, log_flags, tp->t_type);
 		if (error) {
@@ -1214,6 +1226,8 @@ xfs_trans_free(
 {
 	atomic_dec(&tp->t_mountp->m_active_trans);
 	XFS_TRANS_FREE_DQINFO(tp->t_mountp, tp);
+	xfs_btree_free_cursor_cache(tp);
+	xfs_trans_bhash_free(tp);
 	kmem_zone_free(xfs_trans_zone, tp);
 }
 
@@ -751,7 +751,9 @@ xfs_lic_desc_to_chunk(xfs_log_item_desc_t *dp)
 
 #ifdef __KERNEL__
 
+struct xfs_btree_cur;
 struct xfs_buf;
+struct xfs_buf_log_item;
 struct xfs_buftarg;
 struct xfs_efd_log_item;
 struct xfs_efi_log_item;
@@ -851,6 +853,20 @@ typedef struct xfs_log_busy_chunk {
  */
 typedef void (*xfs_trans_callback_t)(struct xfs_trans *, void *);
 
+/*
+ * Number of released btree cursors a transaction keeps for reuse.  The
+ * allocation paths use at most a bno and a cnt cursor plus a duplicate
+ * at any one time, so a handful of slots covers the common cases.
+ */
+#define XFS_TRANS_CUR_CACHE	4
+
+/*
+ * Size of the buffer log item hash built by transactions that outgrow
+ * their embedded log item chunk.
+ */
+#define XFS_TRANS_BHASH_BITS	6
+#define XFS_TRANS_BHASH_SIZE	(1 << XFS_TRANS_BHASH_BITS)
+
 /*
  * This is the structure maintained for every active transaction.
  */
@@ -895,10 +911,14 @@ typedef struct xfs_trans {
 	int64_t			t_rextslog_delta;/* superblocks rextslog chg */
 	unsigned int		t_items_free;	/* log item descs free */
 	xfs_log_item_chunk_t	t_items;	/* first log item desc chunk */
+	struct xfs_buf_log_item	**t_bhash;	/* buf items by blkno, if big */
 	xfs_trans_header_t	t_header;	/* header for in-log trans */
 	unsigned int		t_busy_free;	/* busy descs free */
 	xfs_log_busy_chunk_t	t_busy;		/* busy/async free blocks */
 	unsigned long		t_pflags;	/* saved process flags state */
+	int			t_curcache_cnt;	/* # of cached btree cursors */
+	struct xfs_btree_cur	*t_curcache[XFS_TRANS_CUR_CACHE];
+						/* released btree cursors */
 } xfs_trans_t;
 
 /*
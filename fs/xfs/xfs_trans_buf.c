@@ -44,6 +44,7 @@ STATIC xfs_buf_t *xfs_trans_buf_item_match(xfs_trans_t *, xfs_buftarg_t *,
 		xfs_daddr_t, int);
 STATIC xfs_buf_t *xfs_trans_buf_item_match_all(xfs_trans_t *, xfs_buftarg_t *,
 		xfs_daddr_t, int);
+STATIC void xfs_trans_bhash_insert(xfs_trans_t *, xfs_buf_log_item_t *);
 
 
 /*
@@ -162,6 +163,7 @@ xfs_trans_get_buf(xfs_trans_t	*tp,
 	 * Get a log_item_desc to point at the new item.
 	 */
 	(void) xfs_trans_add_item(tp, (xfs_log_item_t*)bip);
+	xfs_trans_bhash_insert(tp, bip);
 
 	/*
 	 * Initialize b_fsprivate2 so we can find it with incore_match()
@@ -245,6 +247,7 @@ xfs_trans_getsb(xfs_trans_t	*tp,
 	 * Get a log_item_desc to point at the new item.
 	 */
 	(void) xfs_trans_add_item(tp, (xfs_log_item_t*)bip);
+	xfs_trans_bhash_insert(tp, bip);
 
 	/*
 	 * Initialize b_fsprivate2 so we can find it with incore_match()
@@ -457,6 +460,7 @@ xfs_trans_read_buf(
 	 * Get a log_item_desc to point at the new item.
 	 */
 	(void) xfs_trans_add_item(tp, (xfs_log_item_t*)bip);
+	xfs_trans_bhash_insert(tp, bip);
 
 	/*
 	 * Initialize b_fsprivate2 so we can find it with incore_match()
@@ -670,6 +674,7 @@ xfs_trans_bjoin(xfs_trans_t	*tp,
 	 * Get a log_item_desc to point at the new item.
 	 */
 	(void) xfs_trans_add_item(tp, (xfs_log_item_t *)bip);
+	xfs_trans_bhash_insert(tp, bip);
 
 	/*
 	 * Initialize b_fsprivate2 so we can find it with incore_match()
@@ -1052,10 +1057,85 @@ xfs_trans_buf_item_match(
 	return bp;
 }
 
+/*
+ * Hash a buffer address into the transaction's buffer item hash.
+ */
+static inline int
+xfs_trans_bhash(
+	xfs_daddr_t	blkno)
+{
+	return hash_long((unsigned long)blkno, XFS_TRANS_BHASH_BITS);
+}
+
+/*
+ * Add a buffer log item to the transaction's buffer item hash, if the
+ * transaction has one.  The hash only exists once the transaction has
+ * grown beyond its embedded log item chunk.
+ */
+STATIC void
+xfs_trans_bhash_insert(
+	xfs_trans_t		*tp,
+	xfs_buf_log_item_t	*bip)
+{
+	xfs_buf_log_item_t	**bucket;
+
+	if (tp->t_bhash == NULL)
+		return;
+	bucket = &tp->t_bhash[xfs_trans_bhash(XFS_BUF_ADDR(bip->bli_buf))];
+	bip->bli_hnext = *bucket;
+	*bucket = bip;
+}
+
+/*
+ * Remove a buffer log item from the transaction's buffer item hash.
+ * Called whenever the item's descriptor is released from the transaction.
+ */
+void
+xfs_trans_bhash_remove(
+	xfs_trans_t		*tp,
+	xfs_log_item_t		*lip)
+{
+	xfs_buf_log_item_t	*bip = (xfs_buf_log_item_t *)lip;
+	xfs_buf_log_item_t	**bipp;
+
+	ASSERT(lip->li_type == XFS_LI_BUF);
+	if (tp->t_bhash == NULL)
+		return;
+	bipp = &tp->t_bhash[xfs_trans_bhash(XFS_BUF_ADDR(bip->bli_buf))];
+	while (*bipp != NULL) {
+		if (*bipp == bip) {
+			*bipp = bip->bli_hnext;
+			bip->bli_hnext = NULL;
+			return;
+		}
+		bipp = &(*bipp)->bli_hnext;
+	}
+	ASSERT(0);
+}
+
+/*
+ * Tear down the transaction's buffer item hash.  The items themselves
+ * are tracked by the log item chunks, so there is nothing to release
+ * but the bucket array.
+ */
+void
+xfs_trans_bhash_free(
+	xfs_trans_t	*tp)
+{
+	if (tp->t_bhash == NULL)
+		return;
+	kmem_free(tp->t_bhash);
+	tp->t_bhash = NULL;
+}
+
 /*
  * Check to see if a buffer matching the given parameters is already
- * a part of the given transaction.  Check all the chunks, we
- * want to be thorough.
+ * a part of the given transaction.  This is used once the transaction
+ * has spilled out of its embedded chunk; large transactions such as
+ * directory splits and truncates of fragmented files can join dozens
+ * of buffers, so rather than scanning every chunk we build a hash of
+ * the buffer items on first use and keep it up to date as buffers are
+ * joined and released.
  */
 STATIC xfs_buf_t *
 xfs_trans_buf_item_match_all(
@@ -1070,39 +1150,34 @@ xfs_trans_buf_item_match_all(
 	xfs_buf_t		*bp;
 	int			i;
 
-	bp = NULL;
-	len = BBTOB(len);
-	for (licp = &tp->t_items; licp != NULL; licp = licp->lic_next) {
-		if (xfs_lic_are_all_free(licp)) {
-			ASSERT(licp == &tp->t_items);
-			ASSERT(licp->lic_next == NULL);
-			return NULL;
-		}
-		for (i = 0; i < licp->lic_unused; i++) {
-			/*
-			 * Skip unoccupied slots.
-			 */
-			if (xfs_lic_isfree(licp, i)) {
-				continue;
-			}
-
-			lidp = xfs_lic_slot(licp, i);
-			blip = (xfs_buf_log_item_t *)lidp->lid_item;
-			if (blip->bli_item.li_type != XFS_LI_BUF) {
+	if (tp->t_bhash == NULL) {
+		tp->t_bhash = kmem_zalloc(XFS_TRANS_BHASH_SIZE *
+					  sizeof(xfs_buf_log_item_t *),
+					  KM_SLEEP);
+		for (licp = &tp->t_items; licp != NULL; licp = licp->lic_next) {
+			if (xfs_lic_are_all_free(licp))
 				continue;
-			}
-
-			bp = blip->bli_buf;
-			if ((XFS_BUF_TARGET(bp) == target) &&
-			    (XFS_BUF_ADDR(bp) == blkno) &&
-			    (XFS_BUF_COUNT(bp) == len)) {
-				/*
-				 * We found it.  Break out and
-				 * return the pointer to the buffer.
-				 */
-				return bp;
+			for (i = 0; i < licp->lic_unused; i++) {
+				if (xfs_lic_isfree(licp, i))
+					continue;
+				lidp = xfs_lic_slot(licp, i);
+				blip = (xfs_buf_log_item_t *)lidp->lid_item;
+				if (blip->bli_item.li_type != XFS_LI_BUF)
+					continue;
+				xfs_trans_bhash_insert(tp, blip);
 			}
 		}
 	}
+
+	len = BBTOB(len);
+	for (blip = tp->t_bhash[xfs_trans_bhash(blkno)];
+	     blip != NULL;
+	     blip = blip->bli_hnext) {
+		bp = blip->bli_buf;
+		if ((XFS_BUF_TARGET(bp) == target) &&
+		    (XFS_BUF_ADDR(bp) == blkno) &&
+		    (XFS_BUF_COUNT(bp) == len))
+			return bp;
+	}
 	return NULL;
 }
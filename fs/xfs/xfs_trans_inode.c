@@ -265,6 +265,21 @@ xfs_trans_log_inode(
 	tp->t_flags |= XFS_TRANS_DIRTY;
 	lidp->lid_flags |= XFS_LID_DIRTY;
 
+	/*
+	 * Remember what was logged for fsync, then turn a timestamp only
+	 * update into the core logging it really is.  Logging the core
+	 * also logs any di_size update that xfs_setfilesize() left
+	 * unlogged, and clears i_update_size when it does; fdatasync has
+	 * to wait for that, so it cannot be recorded as timestamps only.
+	 */
+	ip->i_itemp->ili_fsync_fields |= flags;
+	if (flags & XFS_ILOG_TIMESTAMP) {
+		if (ip->i_update_size)
+			ip->i_itemp->ili_fsync_fields |= XFS_ILOG_CORE;
+		flags &= ~XFS_ILOG_TIMESTAMP;
+		flags |= XFS_ILOG_CORE;
+	}
+
 	/*
 	 * Always OR in the bits from the ili_last_fields field.
 	 * This is to coordinate with the xfs_iflush() and xfs_iflush_done()
@@ -148,6 +148,8 @@ xfs_trans_free_item(xfs_trans_t	*tp, xfs_log_item_desc_t *lidp)
 
 	slot = xfs_lic_desc_to_slot(lidp);
 	licp = xfs_lic_desc_to_chunk(lidp);
+	if (lidp->lid_item->li_type == XFS_LI_BUF)
+		xfs_trans_bhash_remove(tp, lidp->lid_item);
 	xfs_lic_relse(licp, slot);
 	lidp->lid_item->li_desc = NULL;
 	tp->t_items_free++;
@@ -306,6 +308,7 @@ xfs_trans_free_items(
 	int			abort;
 
 	abort = flags & XFS_TRANS_ABORT;
+	xfs_trans_bhash_free(tp);
 	licp = &tp->t_items;
 	/*
 	 * Special case the embedded chunk so we don't free it below.
@@ -351,6 +354,12 @@ xfs_trans_unlock_items(xfs_trans_t *tp, xfs_lsn_t commit_lsn)
 	xfs_log_item_chunk_t	**licpp;
 	int			freed;
 
+	/*
+	 * No more buffers can be looked up in this transaction, and the
+	 * descriptors of clean items are about to be released.
+	 */
+	xfs_trans_bhash_free(tp);
+
 	freed = 0;
 	licp = &tp->t_items;
 
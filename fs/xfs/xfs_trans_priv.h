@@ -43,6 +43,13 @@ xfs_log_busy_slot_t		*xfs_trans_add_busy(xfs_trans_t *tp,
 						    xfs_agnumber_t ag,
 						    xfs_extlen_t idx);
 
+/*
+ * From xfs_trans_buf.c
+ */
+void				xfs_trans_bhash_remove(struct xfs_trans *,
+						struct xfs_log_item *);
+void				xfs_trans_bhash_free(struct xfs_trans *);
+
 /*
  * AIL traversal cursor.
  *
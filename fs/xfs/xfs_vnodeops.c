@@ -481,6 +481,7 @@ xfs_setattr(
 			ip->i_d.di_atime.t_sec = iattr->ia_atime.tv_sec;
 			ip->i_d.di_atime.t_nsec = iattr->ia_atime.tv_nsec;
 			ip->i_update_core = 1;
+			ip->i_update_lazy = 0;
 		}
 		if (mask & ATTR_MTIME) {
 			inode->i_mtime = iattr->ia_mtime;
@@ -490,7 +491,7 @@ xfs_setattr(
 			timeflags |= XFS_ICHGTIME_CHG;
 		}
 		if (tp && (mask & (ATTR_MTIME_SET|ATTR_ATIME_SET)))
-			xfs_trans_log_inode (tp, ip, XFS_ILOG_CORE);
+			xfs_trans_log_inode (tp, ip, XFS_ILOG_TIMESTAMP);
 	}
 
 	/*
@@ -503,6 +504,7 @@ xfs_setattr(
 		ip->i_d.di_ctime.t_sec = iattr->ia_ctime.tv_sec;
 		ip->i_d.di_ctime.t_nsec = iattr->ia_ctime.tv_nsec;
 		ip->i_update_core = 1;
+		ip->i_update_lazy = 0;
 		timeflags &= ~XFS_ICHGTIME_CHG;
 	}
 
@@ -666,21 +668,35 @@ xfs_readlink(
  * the I/O lock while flushing the data, and the inode lock while flushing the
  * inode.  The inode lock CANNOT be held while flushing the data, so acquire
  * after we're done with that.
+ *
+ * For fdatasync only changes needed to get at the data matter, so neither
+ * unlogged timestamp updates nor committed transactions that only logged
+ * timestamps (see XFS_ILOG_TIMESTAMP) require any log I/O.
  */
 int
 xfs_fsync(
-	xfs_inode_t	*ip)
+	xfs_inode_t	*ip,
+	int		datasync)
 {
+	xfs_inode_log_item_t *iip;
 	xfs_trans_t	*tp;
+	xfs_lsn_t	lsn = 0;
 	int		error;
 	int		log_flushed = 0, changed = 1;
+	int		data_written;
 
 	xfs_itrace_entry(ip);
 
 	if (XFS_FORCED_SHUTDOWN(ip->i_mount))
 		return XFS_ERROR(EIO);
 
-	/* capture size updates in I/O completion before writing the inode. */
+	/*
+	 * capture size updates in I/O completion before writing the inode.
+	 * If there was data under writeback, it has to be flushed out of the
+	 * disk cache even when no log force turns out to be needed below.
+	 */
+	data_written = mapping_tagged(VFS_I(ip)->i_mapping,
+				      PAGECACHE_TAG_WRITEBACK);
 	error = xfs_wait_on_pages(ip, 0, -1);
 	if (error)
 		return XFS_ERROR(error);
@@ -695,33 +711,52 @@ xfs_fsync(
 	 *
 	 * This code relies on the assumption that if the update_* fields
 	 * of the inode are clear and the inode is unpinned then it is clean
-	 * and no action is required.
+	 * and no action is required.  i_update_size is only ever set along
+	 * with i_update_core, so i_update_core on its own means only the
+	 * timestamps are dirty.
 	 */
 	xfs_ilock(ip, XFS_ILOCK_SHARED);
 
-	if (!(ip->i_update_size || ip->i_update_core)) {
+	if (!ip->i_update_size && (datasync || !ip->i_update_core)) {
 		/*
-		 * Timestamps/size haven't changed since last inode flush or
-		 * inode transaction commit.  That means either nothing got
-		 * written or a transaction committed which caught the updates.
-		 * If the latter happened and the transaction hasn't hit the
-		 * disk yet, the inode will be still be pinned.  If it is,
-		 * force the log.
+		 * Nothing fsync cares about has changed since the last inode
+		 * flush or inode transaction commit.  That means either
+		 * nothing got written or a transaction committed which caught
+		 * the updates.  If the latter happened and the transaction
+		 * hasn't hit the disk yet, the inode will be still be pinned.
+		 * If it is, force the log up to the last transaction that
+		 * touched the inode, unless all fdatasync would be waiting
+		 * for is a timestamp update.
+		 *
+		 * The force is done under the ilock so that nobody can log
+		 * the inode again between our look at ili_fsync_fields and
+		 * the clearing of it below.
 		 */
+		iip = ip->i_itemp;
+		if (xfs_ipincount(ip) &&
+		    (!datasync || !iip ||
+		     (iip->ili_fsync_fields & ~XFS_ILOG_TIMESTAMP)))
+			lsn = (iip && iip->ili_last_lsn) ? iip->ili_last_lsn : 0;
+		else {
+			changed = 0;
+			/*
+			 * Skipping a timestamp-only update used to go through
+			 * a sync transaction and its cache flush.  The data
+			 * written before that update may have completed
+			 * before we got here, so still flush for it.
+			 */
+			if (ip->i_update_core || xfs_ipincount(ip))
+				data_written = 1;
+		}
 
-		xfs_iunlock(ip, XFS_ILOCK_SHARED);
-
-		if (xfs_ipincount(ip)) {
-			error = _xfs_log_force(ip->i_mount, (xfs_lsn_t)0,
+		if (changed) {
+			error = _xfs_log_force(ip->i_mount, lsn,
 				      XFS_LOG_FORCE | XFS_LOG_SYNC,
 				      &log_flushed);
-		} else {
-			/*
-			 * If the inode is not pinned and nothing has changed
-			 * we don't need to flush the cache.
-			 */
-			changed = 0;
+			if (!error && iip)
+				iip->ili_fsync_fields = 0;
 		}
+		xfs_iunlock(ip, XFS_ILOCK_SHARED);
 	} else	{
 		/*
 		 * Kick off a transaction to log the inode core to get the
@@ -751,14 +786,19 @@ xfs_fsync(
 		xfs_trans_log_inode(tp, ip, XFS_ILOG_CORE);
 		xfs_trans_set_sync(tp);
 		error = _xfs_trans_commit(tp, 0, &log_flushed);
+		if (!error)
+			ip->i_itemp->ili_fsync_fields = 0;
 
 		xfs_iunlock(ip, XFS_ILOCK_EXCL);
 	}
 
-	if ((ip->i_mount->m_flags & XFS_MOUNT_BARRIER) && changed) {
+	if ((ip->i_mount->m_flags & XFS_MOUNT_BARRIER) &&
+	    (changed || data_written)) {
 		/*
 		 * If the log write didn't issue an ordered tag we need
-		 * to flush the disk cache for the data device now.
+		 * to flush the disk cache for the data device now.  The
+		 * same goes when data was written but the log was not
+		 * forced at all.
 		 */
 		if (!log_flushed)
 			xfs_blkdev_issue_flush(ip->i_mount->m_ddev_targp);
@@ -851,7 +891,8 @@ xfs_free_eofblocks(
 		if (error) {
 			ASSERT(XFS_FORCED_SHUTDOWN(mp));
 			xfs_trans_cancel(tp, 0);
-			xfs_iunlock(ip, XFS_IOLOCK_EXCL);
+			if (use_iolock)
+				xfs_iunlock(ip, XFS_IOLOCK_EXCL);
 			return error;
 		}
 
@@ -1209,6 +1250,14 @@ xfs_inactive(
 
 	xfs_itrace_entry(ip);
 
+	/*
+	 * Nobody can look up names or attributes any more, and the
+	 * inode may be reused before it is reclaimed.
+	 */
+	xfs_dir2_hcache_free(ip);
+	xfs_dir2_fsum_free(ip);
+	xfs_attr_rcache_free(ip);
+
 	/*
 	 * If the inode is already free, then there can be nothing
 	 * to clean up here.
@@ -6503,7 +6503,8 @@ xfsidbg_xnode(xfs_inode_t *ip)
 		xfs_ipincount(ip));
 	kdb_printf("udquotp 0x%p gdquotp 0x%p\n",
 		ip->i_udquot, ip->i_gdquot);
-	kdb_printf("new_size %Ld\n", ip->i_new_size);
+	kdb_printf("new_size %Ld users %d\n", ip->i_new_size,
+		ip->i_new_size_users);
 	printflags((int)ip->i_flags, tab_flags, "flags");
 	kdb_printf("\n");
 	kdb_printf("update_core %d update size %d\n",